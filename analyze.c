@@ -1,34 +1,49 @@
+#include <pthread.h>
 #include "globals.h"
 #include "symtab.h"
 #include "analyze.h"
+#include "stats.h"
+#include "diag.h"
+#include "callgraph.h"
+#include "iface.h"
+#include "frame.h"
 
 /* counter for variable memory locations. */
 static int location = 0;
 
+/* Threads checking function bodies, 1 for serial. */
+int Jobs = 1;
+
+/* State of the function being checked, 
+ * one per thread in parallel mode. */
 /* Saved function name. */
-static char* function_name = NULL;
+static __thread char* function_name = NULL;
 /* Saved Return type. */
-static int returnType = 0;
+static __thread int returnType = 0;
 /* Flag to check existence of return statement. */
-static int existReturn = 0;
-
-/* proto */
-void mainCheck (TreeNode*);
+static __thread int existReturn = 0;
+/* Function whose body is being inserted. */
+static BucketList curFunc = NULL;
+/* A name was not declared when it was inserted. */
+static int unresolved = FALSE;
 
 /* Procedure traverse is a generic recursive 
  * syntax tree traversal routine;
  * it applies preProc in preorder and postProc 
- * in postorder to tree pointed to by t
+ * in postorder to tree pointed to by t.
+ * It stops early once the error limit is reached,
+ * and does not enter nodes marked PARTIAL.
  */
 static void traverse (TreeNode* t, 
 				void (* preProc) (TreeNode *), 
 				void (* postProc) (TreeNode *) ) 
 {
-	if (t != NULL) {
+	if (t != NULL && !diagFull()) {
 		preProc(t);
 		int i;
-		for (i = 0; i < MAXCHILDREN; i++)
-			traverse(t->child[i], preProc, postProc);
+		if (!(t->flags & PARTIAL))
+			for (i = 0; i < MAXCHILDREN; i++)
+				traverse(t->child[i], preProc, postProc);
 
 		if (t->nodekind == DeclK && t->kind.decl == ParamK) {
 			traverse(t->sibling, preProc, postProc);
@@ -42,12 +57,12 @@ static void traverse (TreeNode* t,
 }
 
 /* Function symbolError prints 
- * symbolic error of input source code.
+ * symbolic error of input source code
+ * about a name.
  */
-static void symbolError (int lineno, char* msg) {
+static void symbolError (int lineno, char* msg, char* name) {
 
-	Error = TRUE;
-	fprintf(listing, "Symbolic error at line %d: %s\n", lineno, msg);
+	diagReportName(lineno, ErrorS, SymbolC, msg, name);
 }
 
 /* Function printError prints
@@ -55,8 +70,15 @@ static void symbolError (int lineno, char* msg) {
  */
 static void printError (int lineno, char* msg) {
 
-	Error = TRUE;
-	fprintf(listing, "Semantic error at line %d: %s\n", lineno, msg);
+	diagReport(lineno, ErrorS, SemanticC, msg, NULL);
+}
+
+/* Function callError prints semantic
+ * error of a call of function name.
+ */
+static void callError (int lineno, char* msg, char* name) {
+
+	diagReportName(lineno, ErrorS, SemanticC, msg, name);
 }
 
 /* Function calcLoc calculates
@@ -108,9 +130,11 @@ static void insertNode (TreeNode* t) {
 		case StmtK: 
 			switch(t->kind.stmt) {
 				case CompoundK:
-					if (scope_cont == FALSE) 
+					if (scope_cont == FALSE) {
 						/* Create new scope */
 						scope_push(scope_new());
+						t->scope = scope_top();
+					}
 					else /* Don't create new scope */
 						scope_cont = FALSE;
 					break;
@@ -121,20 +145,19 @@ static void insertNode (TreeNode* t) {
 		case ExpK:
 			switch(t->kind.exp) {
 				case IdK:
-					/* If not declared yet, */
-					if (st_lookup (t->attr.name) == NULL)
-						symbolError(t->lineno, "Undeclared symbol.");
-					/* If declared, append line number. */
-					else 
-						st_insert_global (t->attr.name, t->lineno);
-					break;
 				case CallK:
+					/* Resolve once, appending the line number, 
+					 * and keep the record for later passes. */
+					t->sym = st_reference (t->attr.name, t->lineno);
 					/* If not declared yet, */
-					if (st_lookup (t->attr.name) == NULL)
-						symbolError(t->lineno, "Undeclared symbol.");
-					/* If declared, append line number. */
-					else
-						st_insert_global (t->attr.name, t->lineno);
+					if (t->sym == NULL) {
+						symbolError(t->lineno, "Undeclared symbol.", t->attr.name);
+						unresolved = TRUE;
+					}
+					else if (t->kind.exp == CallK && t->sym->VPF == 'F')
+						cg_addCall(curFunc, t->sym);
+					else if (t->sym->VPF == 'V' && t->sym->owner->level == 0)
+						cg_addUse(curFunc, t->sym);
 					break;
 				default:
 					break;
@@ -146,35 +169,42 @@ static void insertNode (TreeNode* t) {
 					break;
 				case VarK:
 					location = calcLoc(t);
-					/* First declared. */
-					if (st_lookup_local(t->attr.name) == NULL)
-						st_insert(t->attr.name, t->lineno, location, 
-								'V', t->child[0]->type, t->child[0]->len, NULL);
+					/* Insert if first declared. */
+					t->sym = st_declare(t->attr.name, t->lineno, location, 
+							'V', t->child[0]->type, t->child[0]->len, NULL);
 					/* Duplicate declaration. */
-					else 
-						symbolError(t->lineno, "Duplicate var declaration.");
+					if (t->sym == NULL)
+						symbolError(t->lineno, "Duplicate var declaration.", t->attr.name);
 					break;
 				case FunK:
 					location = calcLoc(t);
-					/* If first declared */
-					if (st_lookup(t->attr.name) == NULL) 
-						st_insert(t->attr.name, t->lineno, location, 
-								'F', t->child[0]->type, t->child[0]->len, t->child[1]);
+					/* Insert if first declared, functions are global. */
+					t->sym = st_declare(t->attr.name, t->lineno, location, 
+							'F', t->child[0]->type, t->child[0]->len, t->child[1]);
 					/* Duplicate declaration. */
-					else 
-						symbolError(t->lineno, "Duplicate function declaration.");	
+					if (t->sym == NULL)
+						symbolError(t->lineno, "Duplicate function declaration.", t->attr.name);	
+					else {
+						/* Signature is built once, not per call. */
+						t->sym->sig = st_signature(t->child[1]);
+						cg_addFunction(t->sym, t);
+					}
+					curFunc = t->sym;
+					/* The body of a partial function is not analyzed. */
+					if (t->flags & PARTIAL)
+						break;
 					/* Create new scope. */
 					scope_cont = TRUE;
 					scope_push(scope_new());
+					t->scope = scope_top();
 					break;
 				case ParamK:
-					/* If first declared. */
-					if (st_lookup_local(t->attr.name) == NULL) 
-						st_insert (t->attr.name, t->lineno, 0, 
-								'P', t->child[0]->type, t->child[0]->len, NULL);
+					/* Insert if first declared. */
+					t->sym = st_declare (t->attr.name, t->lineno, 0, 
+							'P', t->child[0]->type, t->child[0]->len, NULL);
 					/* Duplicate declared. */
-					else 
-						symbolError(t->lineno, "Duplicate parameter declaration.");
+					if (t->sym == NULL)
+						symbolError(t->lineno, "Duplicate parameter declaration.", t->attr.name);
 					break;
 			}
 			break;
@@ -193,10 +223,13 @@ static void postInsertNode (TreeNode* t) {
 			&& t->kind.stmt == CompoundK)
 		scope_pop();
 	else if (t->nodekind == DeclK && t->kind.decl == ParamK) {
-		/* directly adjust memory location. */
-		BucketList l = st_lookup(t->attr.name);
-		if (l) l->memloc = calcLoc(t);
+		/* directly adjust memory location, 
+		 * duplicates still take a slot. */
+		location = calcLoc(t);
+		if (t->sym) t->sym->memloc = location;
 	}
+	else if (t->nodekind == DeclK && t->kind.decl == FunK)
+		frameLayout(t);
 	return;
 }
 
@@ -207,32 +240,48 @@ void buildSymtab (TreeNode *syntaxTree) {
 
 	/* Push global scope */
 	scope_push(scope_new());
+	st_declareIntrinsics();
+	importInterfaces();
 	traverse(syntaxTree, insertNode, postInsertNode);
+	cg_finish();
+	diagFlush(listing);
 	if (TraceAnalyze) {
 
+		phaseBegin(PrintP);
 		fprintf(listing, "\nSymbol table:\n\n");
 		printSymTab(listing);
+		phaseEnd(PrintP);
 	}
 	scope_pop();
 	return;
 }
 
+int insertDeclaration (TreeNode* t) {
+
+	unresolved = FALSE;
+	traverse(t, insertNode, postInsertNode);
+	return unresolved;
+}
+
 /* Procedure preCheckNode performs pre type checking
- * at a single tree node. 
+ * at a single tree node. Scopes are re-entered from 
+ * the nodes that opened them, so declarations removed 
+ * after buildSymtab do not shift the others.
  */
 static void preCheckNode (TreeNode* t) {
 
-	static int scope_cont = FALSE;
-	static int i = 1;
-	if (t == NULL || i >= MAX_SCOPE)
+	static __thread int scope_cont = FALSE;
+	if (t == NULL)
 		return;
 	switch(t->nodekind) {
 		case StmtK:
 			switch(t->kind.stmt){
 				case CompoundK:
 					/* Create new scope. */
-					if (scope_cont == FALSE)
-						scope_push(scope[i++]);
+					if (scope_cont == FALSE) {
+						if (t->scope)
+							scope_push(t->scope);
+					}
 					else
 						scope_cont = FALSE;
 					break;
@@ -246,6 +295,8 @@ static void preCheckNode (TreeNode* t) {
 		case DeclK:
 			switch(t->kind.decl) {
 				case FunK:
+					if (t->flags & PARTIAL)
+						break;
 					/* Save function name. */
 					function_name = t->attr.name;
 					/* Save return type. */
@@ -253,7 +304,8 @@ static void preCheckNode (TreeNode* t) {
 						returnType = t->child[0]->type;
 					/* Create new scope. */
 					scope_cont = TRUE;
-					scope_push(scope[i++]);
+					if (t->scope)
+						scope_push(t->scope);
 
 					/* Initialize return statement flag. */
 					existReturn = 0;
@@ -271,30 +323,22 @@ static void preCheckNode (TreeNode* t) {
  * Returns -1 if number of params and args are different, 
  * and returns 0 if type of params and args are different,
  * and returns 1 if no error.
+ * Arguments are walked once against the signature.
  */
-int paramCheck(TreeNode* params, TreeNode* args) {
+int paramCheck(Signature sig, TreeNode* args) {
 	int ret = 1;
-	TreeNode *p, *a;
-	int param_cnt = 0, arg_cnt = 0;
+	int n = 0;
+	TreeNode* a;
 
-	for (p = params; p; p = p->sibling)
-		param_cnt++;
-	for (a = args; a; a = a->sibling)
-		arg_cnt++;
-
-	if (param_cnt != arg_cnt)
-		ret = -1;
-	else {
-		for (p = params, a = args; p && a;
-				p = p->sibling, a = a->sibling) {
-			if (p->child[0] == NULL) 
-				continue; 
-			if (p->child[0]->type != a->type) {
-				ret = 0;
-				break;
-			}
-		}
+	for (a = args; a; a = a->sibling, n++) {
+		if (n >= sig->arity)
+			return -1;
+		if (ret == 1 && sig->types[n] != ANY_TYPE 
+				&& sig->types[n] != a->type)
+			ret = 0;
 	}
+	if (n != sig->arity)
+		return -1;
 
 	return ret;
 }
@@ -355,7 +399,9 @@ static void checkNode (TreeNode* t) {
 					break;
 				case IdK:
 					/* Set type. */
-					entry = st_lookup (t->attr.name);
+					/* Resolved by buildSymtab. Names declared only 
+					 * after their use are still found here. */
+					entry = t->sym ? t->sym : st_lookup (t->attr.name);
 					if (entry == NULL) break;
 					/* Use function as variable. */
 					if (entry->VPF == 'F') {
@@ -376,17 +422,19 @@ static void checkNode (TreeNode* t) {
 					break;
 				case CallK:
 					/* Set type. */
-					entry = st_lookup (t->attr.name);
+					/* Resolved by buildSymtab. Names declared only 
+					 * after their use are still found here. */
+					entry = t->sym ? t->sym : st_lookup (t->attr.name);
 					if (!entry) break;
 					t->type = entry->type;
 					/* If call somthing which is not function. */
 					if (entry->VPF != 'F') 
 						printError(t->lineno, "Not function.");
 					/* Check parameter number & types. */
-					else {
-						switch(paramCheck(entry->params, t->child[0])){
-							case -1: printError(t->lineno, "The number of parameters is invalid."); break;
-							case  0: printError(t->lineno, "Invalid type of argument."); break;
+					else if (entry->sig) {
+						switch(paramCheck(entry->sig, t->child[0])){
+							case -1: callError(t->lineno, "The number of parameters is invalid.", t->attr.name); break;
+							case  0: callError(t->lineno, "Invalid type of argument.", t->attr.name); break;
 							case  1: /* No error */; break;
 						}
 					}
@@ -407,6 +455,8 @@ static void checkNode (TreeNode* t) {
 							printError(t->lineno, "Can't declare void type parameter.");
 					break;
 				case FunK:
+					if (t->flags & PARTIAL)
+						break;
 					if (t->child[0])
 						if (t->child[0]->type == Integer && existReturn == 0)
 							printError(t->lineno, "Integer type function should have return statement.");
@@ -422,24 +472,110 @@ static void checkNode (TreeNode* t) {
 	return;
 }
 
+/* A top level declaration checked by a worker. */
+typedef struct CheckTaskRec {
+
+	TreeNode* decl;
+	DiagList diags;
+	StatsRec stats;
+} CheckTask;
+
+static CheckTask* tasks;
+static int taskCnt;
+/* Next task to take. */
+static int nextTask;
+
+/* Procedure checkWorker takes top level declarations 
+ * in turn and checks each on its own, with its own 
+ * scope stack and diagnostics.
+ */
+static void* checkWorker (void* arg) {
+
+	int i;
+	scope_push(scope[0]);
+	while ((i = __sync_fetch_and_add(&nextTask, 1)) < taskCnt) {
+		CheckTask* task = &tasks[i];
+		TreeNode* sibling = task->decl->sibling;
+		statsLocal = &task->stats;
+		diagCapture(&task->diags);
+		task->decl->sibling = NULL;
+		traverse(task->decl, preCheckNode, checkNode);
+		task->decl->sibling = sibling;
+	}
+	diagCapture(NULL);
+	scope_pop();
+	return NULL;
+}
+
+/* Procedure parallelCheck checks the top level declarations
+ * on Jobs threads. The global scope is read only by now, 
+ * and the diagnostics are replayed in source order, 
+ * so the output is the same as that of the serial traversal.
+ */
+static void parallelCheck (TreeNode* syntaxTree) {
+
+	pthread_t* threads = (pthread_t*) malloc(Jobs * sizeof(pthread_t));
+	TreeNode* t;
+	int i, n = 0;
+
+	for (t = syntaxTree; t; t = t->sibling)
+		n++;
+	tasks = (CheckTask*) calloc(n, sizeof(CheckTask));
+	for (t = syntaxTree, i = 0; t; t = t->sibling, i++)
+		tasks[i].decl = t;
+	taskCnt = n;
+	nextTask = 0;
+	/* Shadow stacks are shared by all scopes, 
+	 * the hash tables can be read concurrently. */
+	ShadowStacks = FALSE;
+
+	for (i = 0; i < Jobs; i++)
+		if (pthread_create(&threads[i], NULL, checkWorker, NULL) != 0) {
+			fprintf(stderr, "Unable to create thread\n");
+			exit(1);
+		}
+	for (i = 0; i < Jobs; i++)
+		pthread_join(threads[i], NULL);
+	for (i = 0; i < n; i++) {
+		diagReplay(&tasks[i].diags);
+		statsMerge(&tasks[i].stats);
+	}
+	free(tasks);
+	free(threads);
+}
+
 /* Procedure typeCheck performs type checking 
  * by a postorder syntax tree traversal.
  */
 void typeCheck (TreeNode* syntaxTree) {
 
 	mainCheck(syntaxTree);
-	scope_push(scope[0]);
-	traverse(syntaxTree, preCheckNode, checkNode);
-	scope_pop();
+	if (Jobs > 1 && !diagFull())
+		parallelCheck(syntaxTree);
+	else {
+		scope_push(scope[0]);
+		traverse(syntaxTree, preCheckNode, checkNode);
+		scope_pop();
+	}
+	diagFlush(listing);
 	return;
 }
 
+void checkDeclaration (TreeNode* t) {
+
+	traverse(t, preCheckNode, checkNode);
+}
+
 /* determine whether main function has valid type 
  */
 void mainCheck (TreeNode* t) {
 
+	/* main is in another unit, or may have been
+	 * skipped by the recovery from a syntax error. */
+	if (LibraryUnit || diagSyntaxErrors() > 0)
+		return;
 	if (!t) {
-		printError (t->lineno, "There does not exist main function.");
+		printError (lineno, "There does not exist main function.");
 		return;
 	}
 	for (; t->sibling && strcmp(t->attr.name, "main"); t = t->sibling) 
@@ -6,8 +6,29 @@
  */
 void buildSymtab (TreeNode *);
 
+/* Function insertDeclaration enters one top level 
+ * declaration into the symbol table, with the global 
+ * scope on top of the stack. Returns TRUE if it uses 
+ * names that are not declared yet.
+ */
+int insertDeclaration (TreeNode *);
+
+/* Procedure checkDeclaration type checks one top level
+ * declaration, with the global scope on top of the stack.
+ */
+void checkDeclaration (TreeNode *);
+
+/* Procedure mainCheck checks that the last declaration
+ * of the list is a valid main function.
+ */
+void mainCheck (TreeNode *);
+
+/* Threads checking function bodies, 1 for serial. */
+extern int Jobs;
+
 /* Procedure typeCheck performs type checking 
- * by a postorder syntax tree traversal
+ * by a postorder syntax tree traversal,
+ * on Jobs threads if Jobs > 1.
  */
 void typeCheck (TreeNode *);
 #endif
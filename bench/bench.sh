@@ -0,0 +1,357 @@
+#!/bin/sh
+#
+#	Benchmark driver for project3_6.
+#
+#	usage: bench.sh run [compiler]        compile the generated corpus and store
+#	                                      the reports in bench/results/<rev>.jsonl
+#	       bench.sh compare <old> <new>   compare two stored results by revision
+#	       bench.sh scale [compiler]      typeCheck time against --jobs
+#	       bench.sh scan [compiler]       scan time against --scan-jobs (0 is getToken)
+#	       bench.sh prelex [compiler]     scan+parse time with and without --prelex
+#	       bench.sh parser [compiler]     parse time of bison and --parser=rd
+#	       bench.sh stream [compiler]     peak RSS and time with and without --stream
+#	       bench.sh dataflow [compiler]   --dataflow time against function size
+#	       bench.sh peephole [compiler]   TM instructions with and without --no-peephole
+#	       bench.sh exec [compiler]       executed TM instructions and cycles with --run
+#	       bench.sh vector [compiler]     executed cycles of scalar and --vectorize code
+#	       bench.sh server [compiler]     separate compiles against requests to --server
+#
+
+DIR=$(dirname "$0")
+GEN=$DIR/gen
+CORPUS=$DIR/corpus
+RESULTS=$DIR/results
+
+# shape and size of every corpus input.
+SPECS="globals:20000 funcs:5000 lib:5000 nest:300 stmts:10000 args:200 comments:100000 exprs:1000"
+
+# field <json> <phase> <key> prints one number of a phase in a report.
+field () {
+	echo "$1" | sed -n "s/.*\"$2\": {[^}]*\"$3\": \([0-9.]*\).*/\1/p"
+}
+
+run () {
+	BIN=${1:-./project3_6}
+	REV=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+	if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+		REV=$REV-dirty
+	fi
+	mkdir -p "$CORPUS" "$RESULTS"
+	OUT=$RESULTS/$REV.jsonl
+	: > "$OUT"
+
+	printf "%-16s%10s%12s%12s%12s%12s%12s%12s\n" input lines "total l/s" \
+		scan parse symtab print check
+	for spec in $SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		# scanning is timed on its own only into the token array.
+		report=$("$BIN" --prelex --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+		echo "{\"input\": \"$shape-$size\", \"report\": $report}" >> "$OUT"
+		printf "%-16s%10s%12s%12s%12s%12s%12s%12s\n" "$shape-$size" \
+			"$(echo "$report" | sed -n 's/.*"lines": \([0-9]*\).*/\1/p')" \
+			"$(field "$report" total lines_per_s)" \
+			"$(field "$report" scan lines_per_s)" \
+			"$(field "$report" parse lines_per_s)" \
+			"$(field "$report" buildSymtab lines_per_s)" \
+			"$(field "$report" printSymTab lines_per_s)" \
+			"$(field "$report" typeCheck lines_per_s)"
+	done
+	echo
+	printf "%-16s" "peak RSS (KB)"
+	printf "%12s" scan parse symtab print check
+	echo
+	while read -r line; do
+		printf "%-16s" "$(echo "$line" | sed 's/^{"input": "\([^"]*\)".*/\1/')"
+		for p in scan parse buildSymtab printSymTab typeCheck; do
+			printf "%12s" "$(field "$line" $p maxrss_kb)"
+		done
+		echo
+	done < "$OUT"
+	echo
+	echo "results stored in $OUT"
+}
+
+# inputs and thread counts of the scaling runs.
+SCALE_SPECS="funcs:20000 lib:20000"
+SCALE_JOBS="1 2 4 8"
+SCAN_SPECS="comments:400000 funcs:20000 exprs:4000"
+SCAN_JOBS="0 1 2 4 8"
+PARSE_SPECS="exprs:4000 args:1000 stmts:10000 funcs:5000"
+STREAM_SPECS="funcs:20000 lib:20000 globals:20000 stmts:10000"
+DATAFLOW_SPECS="stmts:2500 stmts:5000 stmts:10000 stmts:20000 nest:300 funcs:5000"
+PEEPHOLE_SPECS="funcs:5000 stmts:10000 nest:300 exprs:1000 args:200"
+# stmts overflows into loops of billions of steps when run.
+EXEC_SPECS="funcs:5000 nest:300 exprs:1000 args:200"
+VECTOR_SPECS="kernels:1000 kernels:10000 kernels:100000"
+# small units compiled SERVER_COUNT times each.
+SERVER_SPECS="funcs:20 globals:50 kernels:10"
+SERVER_COUNT=200
+
+# sweep <compiler> <option> <phase> <values> <specs> reports the time
+# of one phase on every input for each value of an option.
+sweep () {
+	mkdir -p "$CORPUS"
+	printf "%-18s%8s%12s%12s%10s\n" input "$2" "$3 (s)" "lines/s" speedup
+	for spec in $5; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		base=
+		for v in $4; do
+			report=$("$1" $2=$v --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+			wall=$(field "$report" "$3" wall)
+			[ -n "$base" ] || base=$wall
+			printf "%-18s%8s%12s%12s%10s\n" "$shape-$size" "$v" "$wall" \
+				"$(field "$report" "$3" lines_per_s)" \
+				"$(awk "BEGIN { if ($wall > 0) printf \"%.2f\", $base / $wall }")"
+		done
+	done
+}
+
+scale () {
+	sweep "${1:-./project3_6}" --jobs typeCheck "$SCALE_JOBS" "$SCALE_SPECS"
+}
+
+scan () {
+	sweep "${1:-./project3_6}" --scan-jobs scan "$SCAN_JOBS" "$SCAN_SPECS"
+}
+
+# prelex [compiler] compares scan+parse time of the interleaved
+# getToken path with scanning into the token array first.
+prelex () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%14s%14s%10s\n" input "interleaved" "prelex" ratio
+	for spec in $SCAN_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		set --
+		for opt in "" --prelex; do
+			report=$("$BIN" $opt --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+			set -- "$@" "$(awk "BEGIN { printf \"%.6f\", $(field "$report" scan wall) + $(field "$report" parse wall) }")"
+		done
+		printf "%-18s%14s%14s%10s\n" "$shape-$size" "$1" "$2" \
+			"$(awk "BEGIN { if ($1 > 0) printf \"%.2f\", $2 / $1 }")"
+	done
+}
+
+# parser [compiler] compares the parse time of the two engines on
+# a token array, and cross checks their trees.
+parser () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%12s%12s%12s%10s  %s\n" input lines "bison (s)" "rd (s)" ratio check
+	for spec in $PARSE_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		set --
+		for engine in bison rd; do
+			report=$("$BIN" --prelex --parser=$engine --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+			set -- "$@" "$(field "$report" parse wall)"
+		done
+		check=$("$BIN" --parser=check "$src" 2>&1 >/dev/null | sed -n 's/^Parser check: //p' | tail -n 1)
+		printf "%-18s%12s%12s%12s%10s  %s\n" "$shape-$size" \
+			"$(echo "$report" | sed -n 's/.*"lines": \([0-9]*\).*/\1/p')" "$1" "$2" \
+			"$(awk "BEGIN { if ($1 > 0) printf \"%.2f\", $2 / $1 }")" "$check"
+	done
+}
+
+# peak <json> prints the largest peak RSS of the phases in a report.
+peak () {
+	echo "$1" | grep -o '"maxrss_kb": [0-9]*' | awk '$2 > m { m = $2 } END { print m }'
+}
+
+# stream [compiler] compares the peak RSS and total time of batch
+# compilation with streaming each declaration through the analysis.
+stream () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%14s%14s%12s%12s\n" input "batch RSS" "stream RSS" "batch (s)" "stream (s)"
+	for spec in $STREAM_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		set --
+		for opt in "" --stream; do
+			report=$("$BIN" $opt --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+			set -- "$@" "$(peak "$report")" "$(field "$report" total wall)"
+		done
+		printf "%-18s%14s%14s%12s%12s\n" "$shape-$size" "$1" "$3" "$2" "$4"
+	done
+}
+
+# dataflow [compiler] times liveness and reaching definitions on
+# single functions of growing size, and the solver work.
+dataflow () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%10s%12s%12s%12s%14s\n" input blocks visits "check (s)" "flow (s)" "flow RSS"
+	for spec in $DATAFLOW_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		out=$("$BIN" --dataflow --time-report=json "$src" 2>&1 >/dev/null)
+		report=$(echo "$out" | tail -n 1)
+		summary=$(echo "$out" | grep '^Dataflow:')
+		printf "%-18s%10s%12s%12s%12s%14s\n" "$shape-$size" \
+			"$(echo "$summary" | sed -n 's/.* \([0-9]*\) blocks.*/\1/p')" \
+			"$(echo "$summary" | sed -n 's/.* \([0-9]*\) block visits.*/\1/p')" \
+			"$(field "$report" typeCheck wall)" "$(field "$report" dataflow wall)" \
+			"$(field "$report" dataflow maxrss_kb)"
+	done
+}
+
+# peephole [compiler] counts the TM instructions written with and
+# without the peephole rules, and the time of the code generation.
+peephole () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%12s%12s%10s%12s%12s\n" input emitted written removed "plain (s)" "peep (s)"
+	for spec in $PEEPHOLE_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		plain=$("$BIN" --no-peephole --time-report=json "$src" 2>&1 >/dev/null | tail -n 1)
+		out=$("$BIN" --peephole-report --time-report=json "$src" 2>&1 >/dev/null)
+		report=$(echo "$out" | tail -n 1)
+		summary=$(echo "$out" | grep 'instructions emitted')
+		printf "%-18s%12s%12s%10s%12s%12s\n" "$shape-$size" \
+			"$(echo "$summary" | sed -n 's/^ *\([0-9]*\) instructions.*/\1/p')" \
+			"$(echo "$summary" | sed -n 's/.* \([0-9]*\) written.*/\1/p')" \
+			"$(echo "$summary" | sed -n 's/.*(\(.*\)).*/\1/p')" \
+			"$(field "$plain" codeGen wall)" "$(field "$report" codeGen wall)"
+	done
+}
+
+# exec [compiler] runs the code of every input on the simulator
+# with and without the peephole rules and prints the dynamic cost.
+exec_ () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%14s%14s%14s%14s%12s%12s\n" input "plain instrs" "peep instrs" \
+		"plain cycles" "peep cycles" "peep reads" "peep writes"
+	for spec in $EXEC_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		set --
+		for opt in --no-peephole ""; do
+			run=$("$BIN" $opt --run "$src" 2>&1 >/dev/null </dev/null)
+			set -- "$@" "$(echo "$run" | sed -n 's/^ *\([0-9]*\) instructions,.*/\1/p')" \
+				"$(echo "$run" | sed -n 's/.* \([0-9]*\) cycles.*/\1/p')"
+		done
+		printf "%-18s%14s%14s%14s%14s%12s%12s\n" "$shape-$size" "$1" "$3" "$2" "$4" \
+			"$(echo "$run" | sed -n 's/^ *\([0-9]*\) memory reads.*/\1/p')" \
+			"$(echo "$run" | sed -n 's/.* \([0-9]*\) memory writes.*/\1/p')"
+	done
+}
+
+# vector [compiler] runs the array kernels as scalar code and
+# with --vectorize, and checks that both print the same.
+vector () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%14s%14s%14s%14s%10s%8s\n" input "scalar instrs" "vector instrs" \
+		"scalar cycles" "vector cycles" speedup same
+	for spec in $VECTOR_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		set --
+		for opt in "" --vectorize; do
+			# the program prints its result last
+			out=$("$BIN" $opt --run "$src" 2>"$CORPUS/run.err" </dev/null | tail -n 1)
+			run=$(cat "$CORPUS/run.err")
+			set -- "$@" "$(echo "$run" | sed -n 's/^ *\([0-9]*\) instructions,.*/\1/p')" \
+				"$(echo "$run" | sed -n 's/.* \([0-9]*\) cycles.*/\1/p')" "$out"
+		done
+		rm -f "$CORPUS/run.err"
+		printf "%-18s%14s%14s%14s%14s%10s%8s\n" "$shape-$size" "$1" "$4" "$2" "$5" \
+			"$(awk "BEGIN { if ($5 > 0) printf \"%.2f\", $2 / $5 }")" \
+			"$([ "$3" = "$6" ] && echo yes || echo NO)"
+	done
+}
+
+# server [compiler] compiles every input SERVER_COUNT times, once
+# by a process each and once by requests to one server, and checks
+# that the listings are the same.
+server () {
+	BIN=${1:-./project3_6}
+	mkdir -p "$CORPUS"
+	printf "%-18s%10s%14s%14s%10s%8s\n" input count "process (s)" "server (s)" speedup same
+	for spec in $SERVER_SPECS; do
+		shape=${spec%:*}
+		size=${spec#*:}
+		src=$CORPUS/$shape-$size.tny
+		[ -f "$src" ] || "$GEN" "$shape" "$size" > "$src" || exit 1
+		start=$(date +%s.%N)
+		i=0
+		while [ $i -lt $SERVER_COUNT ]; do
+			"$BIN" "$src" 2>&1
+			i=$((i + 1))
+		done > "$CORPUS/process.out"
+		mid=$(date +%s.%N)
+		i=0
+		while [ $i -lt $SERVER_COUNT ]; do
+			echo "compile $src"
+			i=$((i + 1))
+		done | "$BIN" --server | grep -v '^result ' > "$CORPUS/server.out"
+		end=$(date +%s.%N)
+		same=$(cmp -s "$CORPUS/process.out" "$CORPUS/server.out" && echo yes || echo NO)
+		rm -f "$CORPUS/process.out" "$CORPUS/server.out"
+		printf "%-18s%10s%14s%14s%10s%8s\n" "$shape-$size" $SERVER_COUNT \
+			"$(awk "BEGIN { printf \"%.3f\", $mid - $start }")" \
+			"$(awk "BEGIN { printf \"%.3f\", $end - $mid }")" \
+			"$(awk "BEGIN { if ($end > $mid) printf \"%.2f\", ($mid - $start) / ($end - $mid) }")" \
+			"$same"
+	done
+}
+
+compare () {
+	OLD=$RESULTS/$1.jsonl
+	NEW=$RESULTS/$2.jsonl
+	for f in "$OLD" "$NEW"; do
+		[ -f "$f" ] || { echo "no results $f" >&2; exit 1; }
+	done
+	printf "%-16s%12s%12s%10s%12s%12s\n" input "old wall" "new wall" ratio \
+		"old RSS" "new RSS"
+	while read -r line; do
+		input=$(echo "$line" | sed 's/^{"input": "\([^"]*\)".*/\1/')
+		old=$(grep "\"input\": \"$input\"" "$OLD")
+		[ -n "$old" ] || continue
+		ow=$(field "$old" total wall)
+		nw=$(field "$line" total wall)
+		printf "%-16s%12s%12s%10s%12s%12s\n" "$input" "$ow" "$nw" \
+			"$(awk "BEGIN { if ($ow > 0) printf \"%.2f\", $nw / $ow }")" \
+			"$(field "$old" typeCheck maxrss_kb)" "$(field "$line" typeCheck maxrss_kb)"
+	done < "$NEW"
+}
+
+case "$1" in
+	run) shift; run "$@" ;;
+	compare) [ $# -eq 3 ] || { sed -n '4,17s/^#\t//p' "$0"; exit 1; }; compare "$2" "$3" ;;
+	scale) shift; scale "$@" ;;
+	scan) shift; scan "$@" ;;
+	prelex) shift; prelex "$@" ;;
+	parser) shift; parser "$@" ;;
+	stream) shift; stream "$@" ;;
+	dataflow) shift; dataflow "$@" ;;
+	peephole) shift; peephole "$@" ;;
+	exec) shift; exec_ "$@" ;;
+	vector) shift; vector "$@" ;;
+	server) shift; server "$@" ;;
+	*) sed -n '4,17s/^#\t//p' "$0"; exit 1 ;;
+esac
@@ -0,0 +1,250 @@
+/*
+	File: gen.c
+	Synthetic C-Minus workload generator for benchmarks.
+
+	usage: gen <shape> <size>
+
+	Identifiers may only contain letters, so indices 
+	are written in base 26 after a one letter prefix.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Function name returns prefix followed by i in base 26.
+ * Two buffers are rotated so two names can be used in one printf.
+ */
+static char* name (char prefix, int i) {
+
+	static char buf[4][32];
+	static int cur = 0;
+	char tmp[32];
+	char* s = buf[cur = (cur + 1) % 4];
+	int n = 0, j;
+	do {
+		tmp[n++] = 'a' + i % 26;
+		i /= 26;
+	} while (i > 0);
+	s[0] = prefix;
+	for (j = 0; j < n; j++)
+		s[j + 1] = tmp[n - 1 - j];
+	s[n + 1] = '\0';
+	return s;
+}
+
+static void indent (int n) {
+
+	while (n-- > 0)
+		putchar('\t');
+}
+
+/* Many global scalars and arrays, all referenced from main. */
+static void genGlobals (int size) {
+
+	int i;
+	for (i = 0; i < size; i++) {
+		if (i % 2)
+			printf("int %s[%d];\n", name('g', i), 8 + i % 32);
+		else
+			printf("int %s;\n", name('g', i));
+	}
+	printf("\nvoid main (void) {\n");
+	for (i = 0; i + 1 < size; i += 2)
+		printf("\t%s = %s[%d] + 1;\n", name('g', i), name('g', i + 1), i % 8);
+	printf("}\n");
+}
+
+/* Many small functions, each calling its predecessor. */
+static void genFuncs (int size) {
+
+	int i;
+	printf("int %s;\n\n", name('g', 0));
+	for (i = 0; i < size; i++) {
+		printf("int %s (int pa, int pb) {\n", name('f', i));
+		printf("\tint la;\n\tint lb[4];\n");
+		printf("\tla = pa + pb * %d;\n", i % 100);
+		printf("\tlb[0] = la - %s;\n", name('g', 0));
+		if (i > 0)
+			printf("\tla = %s(la, lb[0]);\n", name('f', i - 1));
+		printf("\tif (la > %d) la = la / 2;\n", i);
+		printf("\treturn la;\n}\n\n");
+	}
+	printf("void main (void) {\n");
+	printf("\t%s = %s(1, 2);\n}\n", name('g', 0), name('f', size - 1));
+}
+
+/* A library of helper functions, few of which are ever called. */
+static void genLib (int size) {
+
+	int i;
+	for (i = 0; i < size; i++) {
+		printf("int %s (int pa) {\n", name('f', i));
+		printf("\tint la;\n\tla = pa * %d;\n", i % 100);
+		if (i % 10)
+			printf("\tla = %s(la);\n", name('f', i - 1));
+		printf("\treturn la;\n}\n\n");
+	}
+	printf("void main (void) {\n\tint la;\n");
+	printf("\tla = %s(1);\n}\n", name('f', size > 10 ? 9 : size - 1));
+}
+
+/* Deeply nested blocks, each declaring a local. */
+static void genNest (int size) {
+
+	int i;
+	printf("int %s;\n\nvoid main (void) {\n", name('g', 0));
+	printf("\tint %s;\n\t%s = 0;\n", name('l', 0), name('l', 0));
+	for (i = 1; i <= size; i++) {
+		indent(i);
+		switch (i % 3) {
+			case 0: printf("while (%s < %d) {\n", name('l', i - 1), i); break;
+			case 1: printf("if (%s > %d) {\n", name('l', i - 1), i); break;
+			default: printf("{\n"); break;
+		}
+		indent(i + 1);
+		printf("int %s;\n", name('l', i));
+		indent(i + 1);
+		printf("%s = %s + %s;\n", name('l', i), name('l', i - 1), name('g', 0));
+	}
+	for (i = size; i >= 1; i--) {
+		indent(i + 1);
+		printf("%s = %s + 1;\n", name('l', i - 1), name('l', i - 1));
+		indent(i);
+		printf("}\n");
+	}
+	printf("}\n");
+}
+
+/* One function with a long statement list. */
+static void genStmts (int size) {
+
+	int i;
+	printf("int %s[64];\n\nvoid main (void) {\n", name('g', 0));
+	printf("\tint la;\n\tint lb;\n\tla = 0;\n\tlb = 1;\n");
+	for (i = 0; i < size; i++) {
+		switch (i % 4) {
+			case 0: printf("\tla = la + lb * %d;\n", i % 1000); break;
+			case 1: printf("\t%s[%d] = la;\n", name('g', 0), i % 64); break;
+			case 2: printf("\tif (la > lb) lb = la - %s[%d];\n", name('g', 0), i % 64); break;
+			default: printf("\twhile (lb < %d) lb = lb + 1;\n", i % 100); break;
+		}
+	}
+	printf("}\n");
+}
+
+/* Functions with wide parameter lists and calls with wide argument lists. */
+static void genArgs (int size) {
+
+	int i, j, funcs = 64;
+	for (i = 0; i < funcs; i++) {
+		printf("int %s (", name('f', i));
+		for (j = 0; j < size; j++)
+			printf("%sint %s", j ? ", " : "", name('p', j));
+		printf(") {\n\treturn %s", name('p', 0));
+		for (j = 1; j < size; j++)
+			printf(" + %s", name('p', j));
+		printf(";\n}\n\n");
+	}
+	printf("void main (void) {\n\tint la;\n\tla = 0;\n");
+	for (i = 0; i < funcs; i++) {
+		printf("\tla = %s(", name('f', i));
+		for (j = 0; j < size; j++)
+			printf("%sla + %d", j ? ", " : "", j);
+		printf(");\n");
+	}
+	printf("}\n");
+}
+
+/* Mostly comments, with a little code. */
+static void genComments (int size) {
+
+	int i;
+	printf("/* generated comment heavy input */\n");
+	printf("int %s;\n\nvoid main (void) {\n", name('g', 0));
+	for (i = 0; i < size; i++) {
+		if (i % 8 == 0)
+			printf("\t/* block comment %d\n\t * spanning ** several\n\t * lines */\n", i);
+		else if (i % 8 == 1)
+			printf("\t%s = %s + %d; /* trailing comment */\n", 
+				name('g', 0), name('g', 0), i % 100);
+		else
+			printf("\t/* line comment %d with / and * inside */\n", i);
+	}
+	printf("}\n");
+}
+
+/* Long arithmetic expressions. */
+static void genExprs (int size) {
+
+	int i, j;
+	printf("int %s[16];\n\nvoid main (void) {\n", name('g', 0));
+	printf("\tint la;\n\tint lb;\n\tla = 1;\n\tlb = 2;\n");
+	for (i = 0; i < size; i++) {
+		printf("\tla = (la + lb * %d - %s[%d])", i % 7 + 1, name('g', 0), i % 16);
+		for (j = 0; j < 6; j++)
+			printf(" %c (lb / %d + la * (%s[%d] - %d))", "+-*"[j % 3], j + 1, 
+				name('g', 0), (i + j) % 16, j);
+		printf(";\n");
+		printf("\tif (la < lb + %d) lb = lb - la * 2;\n", i % 50);
+	}
+	printf("}\n");
+}
+
+/* Loops over global arrays of size elements, counted
+ * kernels and two loops that cannot be vectorized. */
+static void genKernels (int size) {
+
+	const char* a = name('g', 0), * b = name('g', 1), * c = name('g', 2);
+	printf("int %s[%d];\nint %s[%d];\nint %s[%d];\n\n", a, size, b, size, c, size);
+	printf("void main (void) {\n\tint li;\n\tint ln;\n\tint ls;\n\tln = %d;\n", size);
+	printf("\tli = 0;\n\twhile (li < ln) {\n");
+	printf("\t\t%s[li] = li * 3;\n\t\t%s[li] = li + 7;\n\t\tli = li + 1;\n\t}\n", b, c);
+	printf("\tli = 0;\n\twhile (li < ln) {\n");
+	printf("\t\t%s[li] = %s[li] + %s[li];\n\t\tli = li + 1;\n\t}\n", a, b, c);
+	printf("\tli = 0;\n\twhile (li < ln) {\n");
+	printf("\t\t%s[li] = %s[li] * 5 - %s[li] / 2;\n\t\tli = li + 1;\n\t}\n", b, a, c);
+	printf("\tli = 1;\n\twhile (li < ln) {\n");
+	printf("\t\t%s[li] = %s[li - 1] + %s[li];\n\t\tli = li + 1;\n\t}\n", a, a, b);
+	printf("\tls = 0;\n\tli = 0;\n\twhile (li < ln) {\n");
+	printf("\t\tls = ls + %s[li];\n\t\tli = li + 1;\n\t}\n", a);
+	printf("\toutput(ls);\n}\n");
+}
+
+/* Program shapes by name. */
+static struct {
+	const char* name;
+	void (* gen) (int);
+} shapes[] = {
+	{"globals", genGlobals},
+	{"funcs", genFuncs},
+	{"lib", genLib},
+	{"nest", genNest},
+	{"stmts", genStmts},
+	{"args", genArgs},
+	{"comments", genComments},
+	{"exprs", genExprs},
+	{"kernels", genKernels},
+};
+
+#define SHAPE_CNT ((int) (sizeof(shapes) / sizeof(shapes[0])))
+
+int main (int argc, char* argv[]) {
+
+	int i, size;
+	if (argc != 3 || (size = atoi(argv[2])) < 1) {
+		fprintf(stderr, "usage: %s <shape> <size>\nshapes:", argv[0]);
+		for (i = 0; i < SHAPE_CNT; i++)
+			fprintf(stderr, " %s", shapes[i].name);
+		fprintf(stderr, "\n");
+		return 1;
+	}
+	for (i = 0; i < SHAPE_CNT; i++) {
+		if (strcmp(argv[1], shapes[i].name) == 0) {
+			shapes[i].gen(size);
+			return 0;
+		}
+	}
+	fprintf(stderr, "unknown shape %s\n", argv[1]);
+	return 1;
+}
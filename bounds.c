@@ -0,0 +1,620 @@
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "diag.h"
+#include "bounds.h"
+
+int BoundsCheck = FALSE;
+
+/* Bounds past the int range stand for no bound. */
+#define NEG_INF ((long long) INT_MIN - 1)
+#define POS_INF ((long long) INT_MAX + 1)
+
+/* Loop iterations joined before widening,
+ * and narrowing passes after it. */
+#define WIDEN_DELAY 2
+#define NARROW_STEPS 2
+
+/* Loops nested deeper are not iterated: the variables
+ * they assign are unknown at their head. This keeps
+ * deep nests linear instead of exponential. */
+#define MAX_LOOP_DEPTH 4
+
+/* A range of int values. */
+typedef struct IntervalRec {
+	long long lo;
+	long long hi;
+} Interval;
+
+static const Interval top = {NEG_INF, POS_INF};
+
+/* Ranges of the tracked variables at a point,
+ * reach is FALSE if the point cannot be reached. */
+typedef struct EnvRec {
+	int reach;
+	Interval* v;
+} Env;
+
+/* Tracked variables of the function analyzed: the
+ * parameters, then the slots of its frame. */
+static int arity;
+static int slots;
+
+/* Accesses are marked and reported only on the last
+ * pass over a loop, once its ranges are stable. */
+static int collect = TRUE;
+static int loopDepth = 0;
+
+/* Array accesses, those proven in bounds and out. */
+static long accesses = 0;
+static long proven = 0;
+static long outside = 0;
+
+static Env envNew (void) {
+
+	Env e;
+	int i;
+
+	e.reach = TRUE;
+	e.v = (Interval*) malloc((slots + 1) * sizeof(Interval));
+	if (e.v == NULL) {
+		fprintf(stderr, "Out of memory for bounds analysis\n");
+		exit(1);
+	}
+	for (i = 0; i < slots; i++)
+		e.v[i] = top;
+	return e;
+}
+
+static Env envCopy (Env* src) {
+
+	Env e = envNew();
+
+	e.reach = src->reach;
+	memcpy(e.v, src->v, slots * sizeof(Interval));
+	return e;
+}
+
+static void envFree (Env* e) {
+
+	free(e->v);
+	e->v = NULL;
+}
+
+/* Procedure envSet replaces e by src and frees src. */
+static void envSet (Env* e, Env* src) {
+
+	envFree(e);
+	*e = *src;
+	src->v = NULL;
+}
+
+static void join (Env* e, Env* f) {
+
+	int i;
+
+	if (!f->reach)
+		return;
+	if (!e->reach) {
+		e->reach = TRUE;
+		memcpy(e->v, f->v, slots * sizeof(Interval));
+		return;
+	}
+	for (i = 0; i < slots; i++) {
+		if (f->v[i].lo < e->v[i].lo)
+			e->v[i].lo = f->v[i].lo;
+		if (f->v[i].hi > e->v[i].hi)
+			e->v[i].hi = f->v[i].hi;
+	}
+}
+
+/* Procedure widen drops the bounds of e that f exceeds,
+ * so that loops reach a fixpoint in a few steps. */
+static void widen (Env* e, Env* f) {
+
+	int i;
+
+	if (!f->reach)
+		return;
+	if (!e->reach) {
+		join(e, f);
+		return;
+	}
+	for (i = 0; i < slots; i++) {
+		if (f->v[i].lo < e->v[i].lo)
+			e->v[i].lo = NEG_INF;
+		if (f->v[i].hi > e->v[i].hi)
+			e->v[i].hi = POS_INF;
+	}
+}
+
+/* Procedure narrow gives back the bounds widening
+ * dropped, where f found them again. */
+static void narrow (Env* e, Env* f) {
+
+	int i;
+
+	if (!f->reach) {
+		e->reach = FALSE;
+		return;
+	}
+	for (i = 0; i < slots; i++) {
+		if (e->v[i].lo == NEG_INF)
+			e->v[i].lo = f->v[i].lo;
+		if (e->v[i].hi == POS_INF)
+			e->v[i].hi = f->v[i].hi;
+	}
+}
+
+/* Function within returns TRUE if e is contained in f. */
+static int within (Env* e, Env* f) {
+
+	int i;
+
+	if (!e->reach)
+		return TRUE;
+	if (!f->reach)
+		return FALSE;
+	for (i = 0; i < slots; i++)
+		if (e->v[i].lo < f->v[i].lo || e->v[i].hi > f->v[i].hi)
+			return FALSE;
+	return TRUE;
+}
+
+/* Function range makes the result of an operation,
+ * which may wrap around unless both bounds are ints. */
+static Interval range (long long lo, long long hi) {
+
+	Interval r;
+
+	if (lo < INT_MIN || hi > INT_MAX)
+		return top;
+	r.lo = lo;
+	r.hi = hi;
+	return r;
+}
+
+static int bounded (Interval a) {
+
+	return a.lo != NEG_INF && a.hi != POS_INF;
+}
+
+static Interval arith (int op, Interval a, Interval b) {
+
+	long long c[4];
+	int i;
+	Interval r;
+
+	if (!bounded(a) || !bounded(b))
+		return top;
+	switch (op) {
+		case PLUS:
+			return range(a.lo + b.lo, a.hi + b.hi);
+		case MINUS:
+			return range(a.lo - b.hi, a.hi - b.lo);
+		case TIMES:
+		case OVER:
+			if (op == OVER && b.lo <= 0 && b.hi >= 0)
+				return top;
+			c[0] = op == TIMES ? a.lo * b.lo : a.lo / b.lo;
+			c[1] = op == TIMES ? a.lo * b.hi : a.lo / b.hi;
+			c[2] = op == TIMES ? a.hi * b.lo : a.hi / b.lo;
+			c[3] = op == TIMES ? a.hi * b.hi : a.hi / b.hi;
+			r.lo = r.hi = c[0];
+			for (i = 1; i < 4; i++) {
+				if (c[i] < r.lo)
+					r.lo = c[i];
+				if (c[i] > r.hi)
+					r.hi = c[i];
+			}
+			return range(r.lo, r.hi);
+		default:
+			/* comparisons */
+			return range(0, 1);
+	}
+}
+
+/* Function slotOf returns the slot of a tracked
+ * variable, a local int, or -1.
+ */
+static int slotOf (BucketList l) {
+
+	int s;
+
+	if (l == NULL || l->type != Integer || l->owner == NULL
+			|| l->owner->level == 0)
+		return -1;
+	if (l->VPF == 'P')
+		s = l->memloc / 4 - 1;
+	else if (l->VPF == 'V')
+		s = arity + (-l->memloc) / 4 - 2;
+	else
+		return -1;
+	return s >= 0 && s < slots ? s : -1;
+}
+
+/* Function varSlot returns the slot of a
+ * scalar reference, or -1. */
+static int varSlot (TreeNode* t) {
+
+	if (t == NULL || t->nodekind != ExpK || t->kind.exp != IdK
+			|| t->child[0] != NULL)
+		return -1;
+	return slotOf(t->sym);
+}
+
+static void bound (char* buf, long long b) {
+
+	if (b == NEG_INF)
+		strcpy(buf, "-inf");
+	else if (b == POS_INF)
+		strcpy(buf, "+inf");
+	else
+		sprintf(buf, "%lld", b);
+}
+
+/* Procedure checkAccess marks an access to an array
+ * of known length with an index proven in bounds,
+ * and warns of one proven out of bounds.
+ */
+static void checkAccess (TreeNode* t, Interval idx) {
+
+	BucketList l = t->sym;
+	char detail[128], lo[24], hi[24];
+
+	if (!collect || l == NULL || l->type != Array
+			|| l->VPF != 'V' || l->len <= 0)
+		return;
+	if (idx.lo >= 0 && idx.hi < l->len) {
+		t->flags |= IN_BOUNDS;
+		proven++;
+	}
+	else if (idx.hi < 0 || idx.lo >= l->len) {
+		bound(lo, idx.lo);
+		bound(hi, idx.hi);
+		if (idx.lo == idx.hi)
+			snprintf(detail, sizeof(detail), "index %s of %.40s[%d]",
+					lo, l->name, l->len);
+		else
+			snprintf(detail, sizeof(detail), "index in [%s, %s] of %.40s[%d]",
+					lo, hi, l->name, l->len);
+		diagReport(t->lineno, WarningS, SemanticC,
+				"Array index out of bounds.", detail);
+		outside++;
+	}
+}
+
+/* Function eval returns the range of expression t,
+ * applying its assignments to e. Operands are
+ * evaluated left to right.
+ */
+static Interval eval (TreeNode* t, Env* e) {
+
+	Interval a, b;
+	TreeNode* arg;
+	int s;
+
+	if (t == NULL || !e->reach || t->nodekind != ExpK)
+		return top;
+	switch (t->kind.exp) {
+		case ConstK:
+			return range(t->attr.val, t->attr.val);
+		case IdK:
+			if (t->child[0] != NULL) {
+				checkAccess(t, eval(t->child[0], e));
+				return top;
+			}
+			s = slotOf(t->sym);
+			return s >= 0 ? e->v[s] : top;
+		case CallK:
+			for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+				eval(arg, e);
+			return top;
+		case OpK:
+			if (t->attr.op == ASSIGN) {
+				TreeNode* var = t->child[0];
+				if (var != NULL && var->child[0] != NULL)
+					checkAccess(var, eval(var->child[0], e));
+				a = eval(t->child[1], e);
+				if ((s = varSlot(var)) >= 0 && e->reach)
+					e->v[s] = a;
+				return a;
+			}
+			a = eval(t->child[0], e);
+			b = eval(t->child[1], e);
+			return arith(t->attr.op, a, b);
+	}
+	return top;
+}
+
+static int hasAssign (TreeNode* t) {
+
+	int i;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->nodekind == ExpK && t->kind.exp == OpK && t->attr.op == ASSIGN)
+			return TRUE;
+		for (i = 0; i < MAXCHILDREN; i++)
+			if (hasAssign(t->child[i]))
+				return TRUE;
+	}
+	return FALSE;
+}
+
+static int negate (int op) {
+
+	switch (op) {
+		case LT: return GE;
+		case GE: return LT;
+		case LE: return GT;
+		case GT: return LE;
+		case EQ: return NE;
+		default: return EQ;
+	}
+}
+
+/* Function mirror turns a op b into b op a. */
+static int mirror (int op) {
+
+	switch (op) {
+		case LT: return GT;
+		case GT: return LT;
+		case LE: return GE;
+		case GE: return LE;
+		default: return op;
+	}
+}
+
+/* Procedure limit narrows x to the values
+ * for which x op b can hold. */
+static void limit (Interval* x, int op, Interval b) {
+
+	switch (op) {
+		case LT:
+			if (b.hi != POS_INF && b.hi - 1 < x->hi)
+				x->hi = b.hi - 1;
+			break;
+		case LE:
+			if (b.hi < x->hi)
+				x->hi = b.hi;
+			break;
+		case GT:
+			if (b.lo != NEG_INF && b.lo + 1 > x->lo)
+				x->lo = b.lo + 1;
+			break;
+		case GE:
+			if (b.lo > x->lo)
+				x->lo = b.lo;
+			break;
+		case EQ:
+			if (b.lo > x->lo)
+				x->lo = b.lo;
+			if (b.hi < x->hi)
+				x->hi = b.hi;
+			break;
+		case NE:
+			if (b.lo == b.hi && x->lo == b.lo)
+				x->lo++;
+			else if (b.lo == b.hi && x->hi == b.lo)
+				x->hi--;
+			break;
+	}
+}
+
+static int isRelop (int op) {
+
+	return op == LT || op == LE || op == GT || op == GE
+		|| op == EQ || op == NE;
+}
+
+/* Procedure refine narrows e to the states in which
+ * the condition c, already evaluated, has value truth.
+ */
+static void refine (TreeNode* c, Env* e, int truth) {
+
+	Interval a, b, zero = {0, 0};
+	int s, saved = collect, i;
+
+	if (!e->reach || c == NULL || hasAssign(c))
+		return;
+	if (c->nodekind == ExpK && c->kind.exp == OpK && isRelop(c->attr.op)) {
+		int op = truth ? c->attr.op : negate(c->attr.op);
+		collect = FALSE;
+		a = eval(c->child[0], e);
+		b = eval(c->child[1], e);
+		collect = saved;
+		if ((s = varSlot(c->child[0])) >= 0)
+			limit(&e->v[s], op, b);
+		if ((s = varSlot(c->child[1])) >= 0)
+			limit(&e->v[s], mirror(op), a);
+	}
+	else if ((s = varSlot(c)) >= 0)
+		limit(&e->v[s], truth ? NE : EQ, zero);
+	for (i = 0; i < slots; i++)
+		if (e->v[i].lo > e->v[i].hi)
+			e->reach = FALSE;
+}
+
+/* Procedure branch evaluates condition c in e and
+ * splits e into the states where it is true and false.
+ */
+static void branch (TreeNode* c, Env* e, Env* yes, Env* no) {
+
+	eval(c, e);
+	*yes = envCopy(e);
+	*no = envCopy(e);
+	refine(c, yes, TRUE);
+	refine(c, no, FALSE);
+}
+
+/* Procedure havoc forgets the variables assigned in t. */
+static void havoc (TreeNode* t, Env* e) {
+
+	int i, s;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->nodekind == ExpK && t->kind.exp == OpK && t->attr.op == ASSIGN
+				&& (s = varSlot(t->child[0])) >= 0)
+			e->v[s] = top;
+		for (i = 0; i < MAXCHILDREN; i++)
+			havoc(t->child[i], e);
+	}
+}
+
+static void exec (TreeNode* t, Env* e);
+
+/* Procedure loop analyzes a while statement: its head
+ * is iterated to a fixpoint, widened after a few steps
+ * and then narrowed, before the body is checked.
+ */
+static void loop (TreeNode* t, Env* e) {
+
+	Env head = envCopy(e), yes, no, next;
+	int saved = collect, i;
+
+	if (loopDepth >= MAX_LOOP_DEPTH) {
+		havoc(t->child[0], &head);
+		havoc(t->child[1], &head);
+	}
+	else {
+		collect = FALSE;
+		for (i = 0; ; i++) {
+			next = envCopy(&head);
+			branch(t->child[0], &next, &yes, &no);
+			loopDepth++;
+			exec(t->child[1], &yes);
+			loopDepth--;
+			envFree(&next);
+			envFree(&no);
+			next = envCopy(e);
+			join(&next, &yes);
+			envFree(&yes);
+			if (within(&next, &head)) {
+				envFree(&next);
+				break;
+			}
+			if (i < WIDEN_DELAY)
+				join(&head, &next);
+			else
+				widen(&head, &next);
+			envFree(&next);
+		}
+		for (i = 0; i < NARROW_STEPS; i++) {
+			next = envCopy(&head);
+			branch(t->child[0], &next, &yes, &no);
+			loopDepth++;
+			exec(t->child[1], &yes);
+			loopDepth--;
+			envFree(&next);
+			envFree(&no);
+			next = envCopy(e);
+			join(&next, &yes);
+			envFree(&yes);
+			narrow(&head, &next);
+			envFree(&next);
+		}
+		collect = saved;
+	}
+	branch(t->child[0], &head, &yes, &no);
+	loopDepth++;
+	exec(t->child[1], &yes);
+	loopDepth--;
+	envFree(&head);
+	envFree(&yes);
+	envSet(e, &no);
+}
+
+/* Procedure exec analyzes the statement list t. */
+static void exec (TreeNode* t, Env* e) {
+
+	Env yes, no;
+	TreeNode* d;
+	int s;
+
+	for (; t != NULL && e->reach; t = t->sibling) {
+		if (t->flags & PARTIAL)
+			continue;
+		if (t->nodekind == ExpK) {
+			eval(t, e);
+			continue;
+		}
+		if (t->nodekind != StmtK)
+			continue;
+		switch (t->kind.stmt) {
+			case CompoundK:
+				/* A new local holds nothing known. */
+				for (d = t->child[0]; d != NULL; d = d->sibling)
+					if ((s = slotOf(d->sym)) >= 0)
+						e->v[s] = top;
+				exec(t->child[1], e);
+				break;
+			case IfK:
+				branch(t->child[0], e, &yes, &no);
+				exec(t->child[1], &yes);
+				exec(t->child[2], &no);
+				join(&yes, &no);
+				envFree(&no);
+				envSet(e, &yes);
+				break;
+			case WhileK:
+				loop(t, e);
+				break;
+			case ReturnK:
+				eval(t->child[0], e);
+				e->reach = FALSE;
+				break;
+		}
+	}
+}
+
+/* Procedure count counts the array accesses of t. */
+static void count (TreeNode* t) {
+
+	int i;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->nodekind == ExpK && t->kind.exp == IdK && t->child[0] != NULL
+				&& t->sym != NULL && t->sym->type == Array)
+			accesses++;
+		if (!(t->flags & PARTIAL))
+			for (i = 0; i < MAXCHILDREN; i++)
+				count(t->child[i]);
+	}
+}
+
+void boundsDeclaration (TreeNode* t) {
+
+	CallNodeRec* n;
+	Env e;
+
+	if (t == NULL || t->nodekind != DeclK || t->kind.decl != FunK
+			|| (t->flags & PARTIAL) || t->sym == NULL || t->sym->sig == NULL
+			|| t->sym->sig->fid < 0)
+		return;
+	n = &callGraph[t->sym->sig->fid];
+	if (n->frame < 0)
+		return;
+	count(t->child[2]);
+	arity = t->sym->sig->arity;
+	slots = arity + n->frame / 4;
+	/* Parameters hold any value on entry. */
+	e = envNew();
+	exec(t->child[2], &e);
+	envFree(&e);
+}
+
+void boundsCheck (TreeNode* syntaxTree) {
+
+	TreeNode* t;
+
+	for (t = syntaxTree; t != NULL; t = t->sibling)
+		boundsDeclaration(t);
+}
+
+void printBoundsReport (FILE* out) {
+
+	fprintf(out, "Bounds: %ld of %ld array accesses proven in bounds (%.1f%%), "
+			"%ld out of bounds\n", proven, accesses,
+			accesses ? 100.0 * proven / accesses : 100.0, outside);
+}
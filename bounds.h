@@ -0,0 +1,26 @@
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+/* Run the array bounds analysis after type checking. */
+extern int BoundsCheck;
+
+/* Procedure boundsDeclaration computes the range of every
+ * local int variable through a function body by interval
+ * analysis, following the conditions of if and while 
+ * statements. Array accesses whose index is proven within
+ * the array are marked IN_BOUNDS, and a warning is 
+ * reported where the index is proven outside.
+ */
+void boundsDeclaration (TreeNode* t);
+
+/* Procedure boundsCheck analyzes every
+ * function of the syntax tree.
+ */
+void boundsCheck (TreeNode* syntaxTree);
+
+/* Procedure printBoundsReport prints how many array
+ * accesses were proven in bounds.
+ */
+void printBoundsReport (FILE* out);
+
+#endif
@@ -0,0 +1,246 @@
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "util.h"
+
+CallNodeRec* callGraph = NULL;
+int callGraphSize = 0;
+int sccCount = 0;
+
+static int callGraphCap = 0;
+/* capacity of the callee list of every node. */
+static int* calleeCap = NULL;
+/* capacity of the use list of every node. */
+static int* useCap = NULL;
+
+static void* growArray (void* a, int* cap, size_t size) {
+
+	*cap = *cap ? *cap * 2 : 8;
+	a = realloc(a, *cap * size);
+	if (a == NULL) {
+		fprintf(stderr, "Out of memory for call graph\n");
+		exit(1);
+	}
+	return a;
+}
+
+int cg_addFunction (BucketList fn, TreeNode* decl) {
+
+	CallNodeRec* n;
+	if (callGraphSize == callGraphCap) {
+		int old = callGraphCap, cap = old;
+		callGraph = (CallNodeRec*) growArray(callGraph, &callGraphCap, sizeof(CallNodeRec));
+		calleeCap = (int*) growArray(calleeCap, &cap, sizeof(int));
+		cap = old;
+		useCap = (int*) growArray(useCap, &cap, sizeof(int));
+	}
+	n = &callGraph[callGraphSize];
+	n->fn = fn;
+	n->decl = decl;
+	n->lineno = decl ? decl->lineno : 0;
+	n->callees = n->callers = NULL;
+	n->ncallees = n->ncallers = 0;
+	n->uses = NULL;
+	n->nuses = 0;
+	n->scc = -1;
+	n->recursive = FALSE;
+	n->frame = n->unshared = -1;
+	n->params = fn->sig ? 4 * fn->sig->arity : 0;
+	calleeCap[callGraphSize] = 0;
+	useCap[callGraphSize] = 0;
+	if (fn->sig)
+		fn->sig->fid = callGraphSize;
+	return callGraphSize++;
+}
+
+void cg_addCall (BucketList caller, BucketList callee) {
+
+	int from, to;
+	CallNodeRec* n;
+	if (!caller || !callee || !caller->sig || !callee->sig)
+		return;
+	from = caller->sig->fid;
+	to = callee->sig->fid;
+	if (from < 0 || to < 0)
+		return;
+	n = &callGraph[from];
+	/* consecutive calls to the same function are common. */
+	if (n->ncallees > 0 && n->callees[n->ncallees - 1] == to)
+		return;
+	if (n->ncallees == calleeCap[from])
+		n->callees = (int*) growArray(n->callees, &calleeCap[from], sizeof(int));
+	n->callees[n->ncallees++] = to;
+}
+
+void cg_addUse (BucketList fn, BucketList var) {
+
+	CallNodeRec* n;
+	if (!fn || !var || !fn->sig || fn->sig->fid < 0)
+		return;
+	n = &callGraph[fn->sig->fid];
+	if (n->nuses > 0 && n->uses[n->nuses - 1] == var)
+		return;
+	if (n->nuses == useCap[fn->sig->fid])
+		n->uses = (BucketList*) growArray(n->uses, 
+				&useCap[fn->sig->fid], sizeof(BucketList));
+	n->uses[n->nuses++] = var;
+}
+
+static int compareInt (const void* a, const void* b) {
+
+	int x = *(const int*) a, y = *(const int*) b;
+	return x < y ? -1 : (x > y);
+}
+
+/* Procedure findSCC numbers the strongly connected 
+ * components with Tarjan's algorithm, iteratively 
+ * so that long call chains do not overflow the stack.
+ */
+static void findSCC (void) {
+
+	int* index = (int*) malloc(callGraphSize * sizeof(int));
+	int* low = (int*) malloc(callGraphSize * sizeof(int));
+	int* onStack = (int*) malloc(callGraphSize * sizeof(int));
+	int* stack = (int*) malloc(callGraphSize * sizeof(int));
+	/* explicit call stack: node and next edge to visit. */
+	int* work = (int*) malloc(callGraphSize * sizeof(int));
+	int* edge = (int*) malloc(callGraphSize * sizeof(int));
+	int i, sp = 0, wp, counter = 0;
+
+	for (i = 0; i < callGraphSize; i++) {
+		index[i] = -1;
+		onStack[i] = FALSE;
+	}
+	sccCount = 0;
+
+	for (i = 0; i < callGraphSize; i++) {
+		if (index[i] >= 0)
+			continue;
+		wp = 0;
+		work[wp] = i;
+		edge[wp++] = 0;
+		index[i] = low[i] = counter++;
+		stack[sp++] = i;
+		onStack[i] = TRUE;
+		while (wp > 0) {
+			int v = work[wp - 1];
+			CallNodeRec* n = &callGraph[v];
+			if (edge[wp - 1] < n->ncallees) {
+				int w = n->callees[edge[wp - 1]++];
+				if (index[w] < 0) {
+					index[w] = low[w] = counter++;
+					stack[sp++] = w;
+					onStack[w] = TRUE;
+					work[wp] = w;
+					edge[wp++] = 0;
+				}
+				else if (onStack[w] && index[w] < low[v])
+					low[v] = index[w];
+				continue;
+			}
+			/* all edges of v visited. */
+			if (low[v] == index[v]) {
+				int w, size = 0;
+				do {
+					w = stack[--sp];
+					onStack[w] = FALSE;
+					callGraph[w].scc = sccCount;
+					size++;
+				} while (w != v);
+				if (size > 1) {
+					int j;
+					for (j = sp; j < sp + size; j++)
+						callGraph[stack[j]].recursive = TRUE;
+				}
+				sccCount++;
+			}
+			wp--;
+			if (wp > 0 && low[v] < low[work[wp - 1]])
+				low[work[wp - 1]] = low[v];
+		}
+	}
+	free(index); free(low); free(onStack); 
+	free(stack); free(work); free(edge);
+}
+
+void cg_finish (void) {
+
+	int i, j, k;
+	int* callerCap;
+
+	sccCount = 0;
+	if (callGraphSize <= 0)
+		return;
+	callerCap = (int*) calloc(callGraphSize, sizeof(int));
+
+	for (i = 0; i < callGraphSize; i++) {
+		CallNodeRec* n = &callGraph[i];
+		free(n->callers);
+		n->callers = NULL;
+		n->ncallers = 0;
+	}
+	for (i = 0; i < callGraphSize; i++) {
+		CallNodeRec* n = &callGraph[i];
+		if (n->ncallees > 1)
+			qsort(n->callees, n->ncallees, sizeof(int), compareInt);
+		for (j = k = 0; j < n->ncallees; j++)
+			if (k == 0 || n->callees[k - 1] != n->callees[j])
+				n->callees[k++] = n->callees[j];
+		n->ncallees = k;
+		for (j = 0; j < n->ncallees; j++) {
+			CallNodeRec* c = &callGraph[n->callees[j]];
+			if (n->callees[j] == i)
+				n->recursive = TRUE;
+			if (c->ncallers == callerCap[n->callees[j]])
+				c->callers = (int*) growArray(c->callers, 
+						&callerCap[n->callees[j]], sizeof(int));
+			c->callers[c->ncallers++] = i;
+		}
+	}
+	free(callerCap);
+	findSCC();
+}
+
+/* Procedure printNames writes a JSON array of function names. */
+static void printNames (int* ids, int n) {
+
+	int i;
+	outChar('[');
+	for (i = 0; i < n; i++) {
+		if (i > 0) outStr(", ");
+		outChar('"');
+		outStr(callGraph[ids[i]].fn->name);
+		outChar('"');
+	}
+	outChar(']');
+}
+
+void printCallGraph (FILE* out) {
+
+	int i;
+	outOpen(out);
+	outStr("{\"functions\": [");
+	for (i = 0; i < callGraphSize; i++) {
+		CallNodeRec* n = &callGraph[i];
+		outStr(i ? ",\n " : "\n ");
+		outStr("{\"name\": \"");
+		outStr(n->fn->name);
+		outStr("\", \"line\": ");
+		outInt(n->lineno, 0);
+		outStr(", \"arity\": ");
+		outInt(n->fn->sig->arity, 0);
+		outStr(", \"callees\": ");
+		printNames(n->callees, n->ncallees);
+		outStr(", \"callers\": ");
+		printNames(n->callers, n->ncallers);
+		outStr(", \"scc\": ");
+		outInt(n->scc, 0);
+		outStr(", \"recursive\": ");
+		outStr(n->recursive ? "true" : "false");
+		outChar('}');
+	}
+	outStr("\n], \"sccs\": ");
+	outInt(sccCount, 0);
+	outStr("}\n");
+	outFlush();
+}
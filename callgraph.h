@@ -0,0 +1,65 @@
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+/* A function in the call graph. */
+typedef struct CallNodeRec {
+
+	/* symbol table record and declaration. */
+	BucketList fn;
+	TreeNode* decl;
+	/* line of the declaration, 0 if imported. 
+	 * decl is NULL once a streamed declaration is freed. */
+	int lineno;
+	/* indices of the functions called and calling, 
+	 * sorted and without duplicates after cg_finish. */
+	int* callees;
+	int ncallees;
+	int* callers;
+	int ncallers;
+	/* global variables referenced. */
+	BucketList* uses;
+	int nuses;
+	/* strongly connected component, in reverse 
+	 * topological order: callees come first. */
+	int scc;
+	/* TRUE if the function can call itself. */
+	int recursive;
+	/* bytes of locals with sibling blocks sharing slots,
+	 * and without sharing, -1 if the body is not known. */
+	int frame;
+	int unshared;
+	/* bytes of parameters. */
+	int params;
+} CallNodeRec;
+
+/* Functions of the program in declaration order. */
+extern CallNodeRec* callGraph;
+extern int callGraphSize;
+/* Number of strongly connected components. */
+extern int sccCount;
+
+/* Function cg_addFunction adds a function node 
+ * and stores its index in the signature of fn.
+ */
+int cg_addFunction (BucketList fn, TreeNode* decl);
+
+/* Procedure cg_addCall records a call edge. */
+void cg_addCall (BucketList caller, BucketList callee);
+
+/* Procedure cg_addUse records a reference 
+ * to a global variable.
+ */
+void cg_addUse (BucketList fn, BucketList var);
+
+/* Procedure cg_finish sorts the edges, builds the 
+ * caller lists and finds recursion by computing
+ * strongly connected components.
+ */
+void cg_finish (void);
+
+/* Procedure printCallGraph exports the call graph 
+ * as a JSON document.
+ */
+void printCallGraph (FILE* out);
+
+#endif
@@ -0,0 +1,188 @@
+#include "globals.h"
+#include "symtab.h"
+#include "cfg.h"
+
+/* Function grow makes room for n + 1 elements of
+ * the given size in array p of capacity *cap.
+ */
+static void* grow (void* p, int n, int* cap, size_t size) {
+
+	if (n < *cap)
+		return p;
+	*cap = *cap ? *cap * 2 : 4;
+	p = realloc(p, *cap * size);
+	if (p == NULL) {
+		fprintf(stderr, "Out of memory for control flow graph\n");
+		exit(1);
+	}
+	return p;
+}
+
+static int newBlock (Cfg* g) {
+
+	g->blocks = (Block*) grow(g->blocks, g->nblocks, &g->cap, sizeof(Block));
+	memset(&g->blocks[g->nblocks], 0, sizeof(Block));
+	return g->nblocks++;
+}
+
+static void addNode (Cfg* g, int b, TreeNode* t) {
+
+	Block* bl = &g->blocks[b];
+
+	bl->nodes = (TreeNode**) grow(bl->nodes, bl->nnodes,
+			&bl->capNodes, sizeof(TreeNode*));
+	bl->nodes[bl->nnodes++] = t;
+}
+
+static void addEdge (Cfg* g, int from, int to) {
+
+	Block* a = &g->blocks[from];
+	Block* b;
+
+	a->succs = (int*) grow(a->succs, a->nsuccs, &a->capSuccs, sizeof(int));
+	a->succs[a->nsuccs++] = to;
+	b = &g->blocks[to];
+	b->preds = (int*) grow(b->preds, b->npreds, &b->capPreds, sizeof(int));
+	b->preds[b->npreds++] = from;
+}
+
+/* Procedure addVar numbers the declared variable of t
+ * if it is an int scalar. */
+static void addVar (Cfg* g, TreeNode* t) {
+
+	BucketList l = t->sym;
+
+	if (l == NULL || l->type != Integer || l->index >= 0)
+		return;
+	g->vars = (BucketList*) grow(g->vars, g->nvars, &g->capVars, sizeof(BucketList));
+	l->index = g->nvars;
+	g->vars[g->nvars++] = l;
+}
+
+/* Function statements adds the statement list t to
+ * the graph, starting in block b, and returns the block
+ * control leaves it in, -1 if it does not fall through.
+ */
+static int statements (Cfg* g, TreeNode* t, int b) {
+
+	TreeNode* d;
+	int yes, no, head, end;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->flags & PARTIAL)
+			continue;
+		/* Code after a return starts an unreachable block. */
+		if (b < 0)
+			b = newBlock(g);
+		if (t->nodekind == ExpK) {
+			addNode(g, b, t);
+			continue;
+		}
+		if (t->nodekind != StmtK)
+			continue;
+		switch (t->kind.stmt) {
+			case CompoundK:
+				for (d = t->child[0]; d != NULL; d = d->sibling) {
+					addVar(g, d);
+					addNode(g, b, d);
+				}
+				b = statements(g, t->child[1], b);
+				break;
+			case IfK:
+				addNode(g, b, t->child[0]);
+				yes = newBlock(g);
+				addEdge(g, b, yes);
+				yes = statements(g, t->child[1], yes);
+				if (t->child[2] != NULL) {
+					no = newBlock(g);
+					addEdge(g, b, no);
+					no = statements(g, t->child[2], no);
+				}
+				else
+					no = b;
+				b = newBlock(g);
+				if (yes >= 0)
+					addEdge(g, yes, b);
+				if (no >= 0)
+					addEdge(g, no, b);
+				break;
+			case WhileK:
+				head = newBlock(g);
+				addEdge(g, b, head);
+				addNode(g, head, t->child[0]);
+				yes = newBlock(g);
+				addEdge(g, head, yes);
+				end = statements(g, t->child[1], yes);
+				if (end >= 0)
+					addEdge(g, end, head);
+				b = newBlock(g);
+				addEdge(g, head, b);
+				break;
+			case ReturnK:
+				addNode(g, b, t);
+				addEdge(g, b, CFG_EXIT);
+				b = -1;
+				break;
+		}
+	}
+	return b;
+}
+
+Cfg* cfgBuild (TreeNode* t) {
+
+	Cfg* g;
+	TreeNode* p;
+	int end;
+
+	if (t == NULL || t->nodekind != DeclK || t->kind.decl != FunK
+			|| (t->flags & PARTIAL) || t->child[2] == NULL)
+		return NULL;
+	g = (Cfg*) calloc(1, sizeof(struct CfgRec));
+	if (g == NULL) {
+		fprintf(stderr, "Out of memory for control flow graph\n");
+		exit(1);
+	}
+	g->fn = t;
+	newBlock(g);
+	newBlock(g);
+	for (p = t->child[1]; p != NULL; p = p->sibling)
+		if (p->nodekind == DeclK && p->kind.decl == ParamK)
+			addVar(g, p);
+	end = statements(g, t->child[2], CFG_ENTRY);
+	/* Falling off the end returns. */
+	if (end >= 0)
+		addEdge(g, end, CFG_EXIT);
+	return g;
+}
+
+void cfgFree (Cfg* g) {
+
+	int i;
+
+	if (g == NULL)
+		return;
+	for (i = 0; i < g->nblocks; i++) {
+		free(g->blocks[i].nodes);
+		free(g->blocks[i].succs);
+		free(g->blocks[i].preds);
+	}
+	for (i = 0; i < g->nvars; i++)
+		g->vars[i]->index = -1;
+	free(g->blocks);
+	free(g->vars);
+	free(g);
+}
+
+int cfgVar (Cfg* g, TreeNode* t) {
+
+	BucketList l;
+
+	/* An indexed reference is to an array element. */
+	if (t == NULL || (t->nodekind == ExpK && t->child[0] != NULL))
+		return -1;
+	l = t->sym;
+	if (l == NULL || l->index < 0 || l->index >= g->nvars
+			|| g->vars[l->index] != l)
+		return -1;
+	return l->index;
+}
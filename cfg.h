@@ -0,0 +1,56 @@
+#ifndef _CFG_H_
+#define _CFG_H_
+
+/* A basic block of a control flow graph. */
+typedef struct BlockRec {
+
+	/* evaluated in order without branching: expression
+	 * statements, conditions, return statements and
+	 * declarations of locals. */
+	TreeNode** nodes;
+	int nnodes;
+	int capNodes;
+	/* indices of the successor and predecessor blocks. */
+	int* succs;
+	int nsuccs;
+	int capSuccs;
+	int* preds;
+	int npreds;
+	int capPreds;
+} Block;
+
+/* Blocks every graph starts with. */
+#define CFG_ENTRY 0
+#define CFG_EXIT 1
+
+/* Control flow graph of a function body. */
+typedef struct CfgRec {
+
+	TreeNode* fn;
+	Block* blocks;
+	int nblocks;
+	int cap;
+	/* int variables of the function, parameters first,
+	 * numbered by their index field. */
+	BucketList* vars;
+	int nvars;
+	int capVars;
+} Cfg;
+
+/* Function cfgBuild builds the control flow graph of
+ * function declaration t from its IfK, WhileK, ReturnK
+ * and CompoundK statements. It returns NULL for a
+ * declaration that is partial or has no body.
+ */
+Cfg* cfgBuild (TreeNode* t);
+
+/* Procedure cfgFree frees g and clears the
+ * index of its variables. */
+void cfgFree (Cfg* g);
+
+/* Function cfgVar returns the number of a scalar
+ * int variable of g referenced by t, or -1.
+ */
+int cfgVar (Cfg* g, TreeNode* t);
+
+#endif
@@ -0,0 +1,474 @@
+/*
+	File: cgen.c
+	The code generator implementation
+	for the C-Minus compiler
+	(generates code for the TM machine)
+*/
+
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "diag.h"
+#include "code.h"
+#include "vector.h"
+#include "cgen.h"
+
+/* Memory locations of the symbol table are in bytes,
+ * TM addresses words. */
+#define WORD 4
+
+/* The frame of a call, from the frame pointer:
+ * parameters above it, then the control link at 0,
+ * the return address at -1 and the locals below.
+ * Temporaries follow the deepest local. */
+#define RET_ADDR (-1)
+
+/* tmpOffset is the memory offset for temps
+ * It is decremented each time a temp is
+ * stored, and incremeted when loaded again
+ */
+static int tmpOffset = 0;
+
+/* code location of each function by index in
+ * the call graph, -1 until it is generated */
+static int* funcAddr = NULL;
+
+/* Calls waiting for the location of their function. */
+typedef struct CallFixRec {
+	int loc;
+	BucketList fn;
+} CallFix;
+
+static CallFix* fixes = NULL;
+static int fixCnt = 0;
+static int fixCap = 0;
+
+/* Induction variable of the vectorized loop being
+ * generated, whose loads are offset by the lane. */
+static BucketList laneIv = NULL;
+static int laneOff = 0;
+
+/* prototype for internal recursive code generator */
+static void cGen (TreeNode* tree);
+static void genExp (TreeNode* tree);
+
+/* Function local returns TRUE for a variable
+ * in the frame of a function. */
+static int local (BucketList l) {
+
+	return l->owner != NULL && l->owner->level > 0;
+}
+
+/* Function address returns the offset of variable l
+ * from its base register, fp or gp. A global is
+ * located at the end of its memory.
+ */
+static int address (BucketList l) {
+
+	if (local(l))
+		return l->memloc / WORD;
+	return l->memloc / WORD - (l->type == Array ? l->len : 1);
+}
+
+/* Procedure genBase loads register r with the address
+ * of the first element of array l. An array parameter
+ * holds the address passed by the caller.
+ */
+static void genBase (BucketList l, int r) {
+
+	if (l->VPF == 'P')
+		emitRM("LD", r, address(l), fp, "load array parameter");
+	else
+		emitRM("LDA", r, address(l), local(l) ? fp : gp, "load array base");
+}
+
+/* Procedure genElement leaves in ac the address
+ * of the element of array reference t. */
+static void genElement (TreeNode* t) {
+
+	genExp(t->child[0]);
+	genBase(t->sym, ac1);
+	emitRO("ADD", ac, ac1, ac, "element address");
+}
+
+/* Procedure genReturn returns from the running
+ * function, with its value in ac. */
+static void genReturn (void) {
+
+	emitRM("LD", ac1, RET_ADDR, fp, "load return address");
+	emitRM("LD", fp, 0, fp, "restore frame pointer");
+	emitRM("LDA", pc, 0, ac1, "return");
+}
+
+/* Procedure genCall generates a call. The arguments are
+ * stored below the temporaries in use, where the
+ * parameters of the new frame go.
+ */
+static void genCall (TreeNode* tree) {
+
+	TreeNode* arg;
+	int top = tmpOffset, n = 0, k = 0, saved = tmpOffset;
+
+	if (TraceCode) emitComment("-> call");
+	for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+		n++;
+	/* Temporaries of the arguments go below them. */
+	tmpOffset -= n;
+	for (arg = tree->child[0]; arg != NULL; arg = arg->sibling) {
+		genExp(arg);
+		emitRM("ST", ac, top - k++, fp, "store argument");
+	}
+	tmpOffset = saved;
+	emitRM("ST", fp, top - n, fp, "store control link");
+	emitRM("LDA", fp, top - n, fp, "push frame");
+	emitRM("LDA", ac, 2, pc, "return address");
+	emitRM("ST", ac, RET_ADDR, fp, "store return address");
+	if (fixCnt == fixCap) {
+		fixCap = fixCap ? fixCap * 2 : 64;
+		fixes = (CallFix*) realloc(fixes, fixCap * sizeof(CallFix));
+		if (fixes == NULL) {
+			fprintf(stderr, "Out of memory for code\n");
+			exit(1);
+		}
+	}
+	fixes[fixCnt].loc = emitSkip(1);
+	fixes[fixCnt].fn = tree->sym;
+	fixCnt++;
+	if (TraceCode) emitComment("<- call");
+}
+
+/* Procedure genVector generates the vector part of a loop
+ * marked VECTOR_LOOP by vectorDeclaration: while i plus
+ * VECTOR_WIDTH - 1 passes the test, the body is run for
+ * i to i + VECTOR_WIDTH - 1 and i is advanced by
+ * VECTOR_WIDTH. The scalar loop that follows runs the
+ * remaining iterations.
+ */
+static void genVector (TreeNode* tree) {
+
+	TreeNode* body = tree->child[1], * s;
+	BucketList iv = tree->child[0]->child[0]->sym;
+	int savedLoc1, savedLoc2, currentLoc, k;
+
+	if (TraceCode) emitComment("-> vector");
+	if (body->nodekind == StmtK && body->kind.stmt == CompoundK)
+		body = body->child[1];
+	laneIv = iv;
+	savedLoc1 = emitSkip(0);
+	laneOff = VECTOR_WIDTH - 1;
+	genExp(tree->child[0]);
+	savedLoc2 = emitSkip(1);
+	/* the last statement is the increment */
+	for (k = 0; k < VECTOR_WIDTH; k++) {
+		laneOff = k;
+		for (s = body; s->sibling != NULL; s = s->sibling) {
+			emitSource(s->lineno);
+			genExp(s);
+		}
+	}
+	laneIv = NULL;
+	laneOff = 0;
+	emitSource(tree->lineno);
+	emitRM("LD", ac, address(iv), local(iv) ? fp : gp, "load induction variable");
+	emitRM("LDA", ac, VECTOR_WIDTH, ac, "next vector");
+	emitRM("ST", ac, address(iv), local(iv) ? fp : gp, "store induction variable");
+	emitRM_Abs("LDA", pc, savedLoc1, "vector: jmp back");
+	currentLoc = emitSkip(0);
+	emitBackup(savedLoc2);
+	emitRM_Abs("JEQ", ac, currentLoc, "vector: jmp to remainder");
+	emitRestore();
+	if (TraceCode) emitComment("<- vector");
+}
+
+/* Procedure genStmt generates code at a statement node */
+static void genStmt (TreeNode* tree) {
+
+	TreeNode* p1, * p2, * p3;
+	int savedLoc1, savedLoc2, currentLoc;
+
+	switch (tree->kind.stmt) {
+
+		case CompoundK:
+			cGen(tree->child[1]);
+			break;
+
+		case IfK:
+			if (TraceCode) emitComment("-> if");
+			p1 = tree->child[0];
+			p2 = tree->child[1];
+			p3 = tree->child[2];
+			/* generate code for test expression */
+			genExp(p1);
+			savedLoc1 = emitSkip(1);
+			emitComment("if: jump to else belongs here");
+			/* recurse on then part */
+			cGen(p2);
+			savedLoc2 = emitSkip(1);
+			emitComment("if: jump to end belongs here");
+			currentLoc = emitSkip(0);
+			emitBackup(savedLoc1);
+			emitRM_Abs("JEQ", ac, currentLoc, "if: jmp to else");
+			emitRestore();
+			/* recurse on else part */
+			cGen(p3);
+			currentLoc = emitSkip(0);
+			emitBackup(savedLoc2);
+			emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
+			emitRestore();
+			if (TraceCode) emitComment("<- if");
+			break;
+
+		case WhileK:
+			if (tree->flags & VECTOR_LOOP)
+				genVector(tree);
+			if (TraceCode) emitComment("-> while");
+			p1 = tree->child[0];
+			p2 = tree->child[1];
+			savedLoc1 = emitSkip(0);
+			emitComment("while: jump back here");
+			genExp(p1);
+			savedLoc2 = emitSkip(1);
+			emitComment("while: jump to end belongs here");
+			cGen(p2);
+			emitSource(tree->lineno);
+			emitRM_Abs("LDA", pc, savedLoc1, "while: jmp back");
+			currentLoc = emitSkip(0);
+			emitBackup(savedLoc2);
+			emitRM_Abs("JEQ", ac, currentLoc, "while: jmp to end");
+			emitRestore();
+			if (TraceCode) emitComment("<- while");
+			break;
+
+		case ReturnK:
+			if (TraceCode) emitComment("-> return");
+			if (tree->child[0] != NULL)
+				genExp(tree->child[0]);
+			genReturn();
+			if (TraceCode) emitComment("<- return");
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Procedure genExp generates code at an expression node */
+static void genExp (TreeNode* tree) {
+
+	TreeNode* p1, * p2;
+	BucketList l;
+
+	switch (tree->kind.exp) {
+
+		case ConstK:
+			if (TraceCode) emitComment("-> Const");
+			/* gen code to load integer constant using LDC */
+			emitRM("LDC", ac, tree->attr.val, 0, "load const");
+			if (TraceCode) emitComment("<- Const");
+			break;
+
+		case IdK:
+			if (TraceCode) emitComment("-> Id");
+			l = tree->sym;
+			if (tree->child[0] != NULL) {
+				genElement(tree);
+				emitRM("LD", ac, 0, ac, "load element");
+			}
+			/* An array argument is passed by address. */
+			else if (l->type == Array)
+				genBase(l, ac);
+			else {
+				emitRM("LD", ac, address(l), local(l) ? fp : gp, "load id value");
+				if (l == laneIv && laneOff != 0)
+					emitRM("LDA", ac, laneOff, ac, "lane offset");
+			}
+			if (TraceCode) emitComment("<- Id");
+			break;
+
+		case CallK:
+			/* The runtime functions are single instructions. */
+			if (tree->sym->intrinsic == INPUT_INTRINSIC)
+				emitRO("IN", ac, 0, 0, "input");
+			else if (tree->sym->intrinsic == OUTPUT_INTRINSIC) {
+				genExp(tree->child[0]);
+				emitRO("OUT", ac, 0, 0, "output");
+			}
+			else
+				genCall(tree);
+			break;
+
+		case OpK:
+			if (TraceCode) emitComment("-> Op");
+			p1 = tree->child[0];
+			p2 = tree->child[1];
+			if (tree->attr.op == ASSIGN) {
+				l = p1->sym;
+				if (p1->child[0] != NULL) {
+					genElement(p1);
+					emitPush(ac, tmpOffset--, "op: push element address");
+					genExp(p2);
+					emitPop(ac1, ++tmpOffset, "op: load element address");
+					emitRM("ST", ac, 0, ac1, "assign: store element");
+				}
+				else {
+					genExp(p2);
+					emitRM("ST", ac, address(l), local(l) ? fp : gp, "assign: store value");
+				}
+				if (TraceCode) emitComment("<- Op");
+				break;
+			}
+			/* gen code for ac = left arg */
+			genExp(p1);
+			/* gen code to push left operand */
+			emitPush(ac, tmpOffset--, "op: push left");
+			/* gen code for ac = right operand */
+			genExp(p2);
+			/* now load left operand */
+			emitPop(ac1, ++tmpOffset, "op: load left");
+			switch (tree->attr.op) {
+				case PLUS:
+					emitRO("ADD", ac, ac1, ac, "op +");
+					break;
+				case MINUS:
+					emitRO("SUB", ac, ac1, ac, "op -");
+					break;
+				case TIMES:
+					emitRO("MUL", ac, ac1, ac, "op *");
+					break;
+				case OVER:
+					emitRO("DIV", ac, ac1, ac, "op /");
+					break;
+				default:
+					emitRO("SUB", ac, ac1, ac, "op compare");
+					emitRM(tree->attr.op == LT ? "JLT" : tree->attr.op == LE ? "JLE"
+							: tree->attr.op == GT ? "JGT" : tree->attr.op == GE ? "JGE"
+							: tree->attr.op == EQ ? "JEQ" : "JNE",
+							ac, 2, pc, "br if true");
+					emitRM("LDC", ac, 0, ac, "false case");
+					emitRM("LDA", pc, 1, pc, "unconditional jmp");
+					emitRM("LDC", ac, 1, ac, "true case");
+					break;
+			}
+			if (TraceCode) emitComment("<- Op");
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Procedure genFunction generates the body of function
+ * declaration tree, entered with its frame pushed. */
+static void genFunction (TreeNode* tree) {
+
+	CallNodeRec* n = &callGraph[tree->sym->sig->fid];
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "function %.40s", tree->attr.name);
+	emitComment(buf);
+	funcAddr[tree->sym->sig->fid] = emitSkip(0);
+	/* temporaries start below the deepest local */
+	tmpOffset = RET_ADDR - 1 - n->frame / WORD;
+	cGen(tree->child[2]);
+	/* falling off the end returns */
+	emitSource(tree->lineno);
+	genReturn();
+}
+
+/* Procedure cGen recursively generates code by
+ * tree traversal
+ */
+static void cGen (TreeNode* tree) {
+
+	for (; tree != NULL; tree = tree->sibling) {
+		emitSource(tree->lineno);
+		switch (tree->nodekind) {
+			case StmtK:
+				genStmt(tree);
+				break;
+			case ExpK:
+				genExp(tree);
+				break;
+			case DeclK:
+				/* storage was laid out by buildSymtab */
+				if (tree->kind.decl == FunK && tree->child[2] != NULL)
+					genFunction(tree);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+int externalCheck (TreeNode* t) {
+
+	int i, n = 0;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->nodekind == ExpK && (t->kind.exp == IdK || t->kind.exp == CallK)
+				&& t->sym != NULL && t->sym->imported)
+			n++;
+		for (i = 0; i < MAXCHILDREN; i++)
+			n += externalCheck(t->child[i]);
+	}
+	return n;
+}
+
+void codeGen (TreeNode* syntaxTree, char* codefile) {
+
+	char* s = malloc(strlen(codefile) + 7);
+	BucketList l = NULL;
+	int i, mainLoc;
+
+	strcpy(s, "File: ");
+	strcat(s, codefile);
+	emitComment("C-Minus Compilation to TM Code");
+	emitComment(s);
+	free(s);
+	funcAddr = (int*) malloc((callGraphSize + 1) * sizeof(int));
+	for (i = 0; i < callGraphSize; i++)
+		funcAddr[i] = -1;
+	/* generate standard prelude */
+	emitSource(0);
+	emitComment("Standard prelude:");
+	emitRM("LD", fp, 0, ac, "load maxaddress from location 0");
+	emitRM("ST", ac, 0, ac, "clear location 0");
+	emitComment("End of standard prelude.");
+	/* call main with its frame at the top of memory */
+	emitRM("ST", fp, 0, fp, "store control link");
+	emitRM("LDA", ac, 2, pc, "return address");
+	emitRM("ST", ac, RET_ADDR, fp, "store return address");
+	mainLoc = emitSkip(1);
+	emitRO("HALT", 0, 0, 0, "");
+	/* generate code for C-Minus program */
+	cGen(syntaxTree);
+
+	for (i = 0; i < callGraphSize; i++)
+		if (strcmp(callGraph[i].fn->name, "main") == 0)
+			l = callGraph[i].fn;
+	emitBackup(mainLoc);
+	if (l != NULL && funcAddr[l->sig->fid] >= 0)
+		emitRM("LDC", pc, funcAddr[l->sig->fid], 0, "call main");
+	else
+		emitRO("HALT", 0, 0, 0, "no main");
+	for (i = 0; i < fixCnt; i++) {
+		Signature sig = fixes[i].fn->sig;
+		int a = sig != NULL && sig->fid >= 0 ? funcAddr[sig->fid] : -1;
+		emitBackup(fixes[i].loc);
+		/* externalCheck leaves no call without code. */
+		if (a < 0)
+			emitRO("HALT", 0, 0, 0, "call of a function without code");
+		else
+			emitRM("LDC", pc, a, 0, "call");
+	}
+	emitRestore();
+	/* finish */
+	emitComment("End of execution.");
+	codeFlush(code);
+
+	free(funcAddr);
+	free(fixes);
+	funcAddr = NULL;
+	fixes = NULL;
+	fixCnt = fixCap = 0;
+}
@@ -0,0 +1,25 @@
+/*
+	File: cgen.h
+	The code generator interface to the C-Minus compiler
+*/
+
+#ifndef _CGEN_H_
+#define _CGEN_H_
+
+/* Procedure codeGen generates code to a code
+ * file by traversal of the syntax tree. The
+ * second parameter (codefile) is the file name
+ * of the code file, and is used to print the
+ * file name as a comment in the code file
+ */
+void codeGen (TreeNode* syntaxTree, char* codefile);
+
+/* Function externalCheck returns the number of uses of
+ * symbols imported from another unit, which have no code
+ * or memory in this one. There is no linker of TM code,
+ * so such a unit gets no code file. The source itself is
+ * correct, so nothing is reported as an error.
+ */
+int externalCheck (TreeNode* syntaxTree);
+
+#endif
@@ -9,15 +9,26 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "symtab.h"
+#include "diag.h"
+#include "stats.h"
+#include "tokens.h"
+#include "rdparse.h"
+#include "stream.h"
 
 #define YYSTYPE TreeNode*
 static char* savedName;
 static int savedLineno;
 static int savedNum;
 static TreeNode* savedTree;
+/* Syntax errors since the last declaration was reduced. */
+static int declErrors = 0;
 
 int yyerror(char*);
 static int yylex(void);
+static TreeNode* addDeclaration(TreeNode* list, TreeNode* t);
+
+ParserKind Parser = BisonE;
 
 %}
 
@@ -43,31 +54,37 @@ program: declaration_list
 			{ savedTree = $1; }
 	   ;
 
+/* savedTree is kept up to date, so the declarations
+ * parsed so far survive an aborted parse.
+ */
 declaration_list: declaration_list declaration 
-					{
-					  YYSTYPE t = $1;
-					  if (t){
-						for(; t->sibling != NULL; t = t->sibling)
-							;
-						t->sibling = $2;
-						$$ = $1;
-					  }
-					  else
-						  $$ = $2;
-				  	}
+					{ $$ = addDeclaration($1, $2); }
 				| declaration 
-					{ $$ = $1;}
+					{ $$ = addDeclaration(NULL, $1); }
 				;
 
+/* Panic mode recovery skips to the end of a declaration.
+ * A function whose body had a recovered error is marked 
+ * PARTIAL, analysis enters its signature but skips its body.
+ */
 declaration: var_declaration 
-				{ $$ = $1;}
+				{ $$ = $1; declErrors = 0; }
 		   | fun_declaration
-			    { $$ = $1;}		
+			    { 
+					$$ = $1;
+					if (declErrors > 0)
+						$$->flags |= PARTIAL;
+					declErrors = 0;
+				}		
+		   | error SEMI
+		   		{ $$ = NULL; declErrors = 0; yyerrok; if (diagFull()) YYABORT; }
+		   | error RCURLY
+		   		{ $$ = NULL; declErrors = 0; yyerrok; if (diagFull()) YYABORT; }
 		   ;
 
 id: ID 
 	{ 
-		savedName = copyString(tokenString); 
+		savedName = tokenName(); 
 		savedLineno = lineno;
 
 		$$ = newExpNode(IdK);
@@ -180,6 +197,14 @@ compound_stmt: LCURLY local_declarations statement_list RCURLY
 					$$->child[0] = $2;
 					$$->child[1] = $3;
 				}
+			 | LCURLY local_declarations statement_list error RCURLY
+				{
+					$$ = newStmtNode(CompoundK);
+					$$->child[0] = $2;
+					$$->child[1] = $3;
+					yyerrok;
+					if (diagFull()) YYABORT;
+				}
 			 ;
 
 local_declarations: local_declarations var_declaration
@@ -197,6 +222,10 @@ local_declarations: local_declarations var_declaration
 				  | { $$ = NULL; } 
 				  ;
 
+/* An error anywhere in a statement, also in the body of
+ * an if or while, skips to the next semicolon or to the
+ * closing brace of the block.
+ */
 statement_list: statement_list statement
 				{ 
 					YYSTYPE t = $1;
@@ -209,6 +238,8 @@ statement_list: statement_list statement
 					else
 						$$ = $2;
 				}
+			  | statement_list error SEMI
+			 	{ $$ = $1; yyerrok; if (diagFull()) YYABORT; }
 			  | { $$ = NULL; }
 			  ;
 
@@ -384,21 +415,64 @@ arg_list: arg_list COMMA expression
 
 int yyerror(char* msg) {
 
-	fprintf(listing, "Syntax error at line %d: %s\n", lineno, msg);
-	fprintf(listing, "Current token: ");
-	printToken(yychar, tokenString);
-	Error = TRUE;
+	char detail[MAXTOKENLEN + 64];
+	snprintf(detail, sizeof(detail), "Current token: \t%s\t\t%s", 
+		tokenLabel(yychar), tokenLexeme(yychar, tokenString));
+	diagReport(lineno, ErrorS, SyntaxC, msg, detail);
+	declErrors++;
 	return 0;
 }
 
+/* Last declaration of the list, so appending
+ * does not walk the whole list. */
+static TreeNode* lastDeclaration;
+
+/* Function addDeclaration appends t to the declarations
+ * parsed so far, or hands it to the analysis in 
+ * streaming mode, where no list is kept.
+ */
+static TreeNode* addDeclaration(TreeNode* list, TreeNode* t) {
+
+	if (Streaming)
+		streamDeclaration(t);
+	else if (t != NULL) {
+		if (list)
+			lastDeclaration->sibling = t;
+		else
+			list = t;
+		lastDeclaration = t;
+	}
+	savedTree = list;
+	return list;
+}
+
 static int yylex(void) {
 
-	TokenType t = getToken();
-	return t;
+	/* Timing every token would mostly measure the clock,
+	 * interleaved scanning is timed as part of parse. */
+	return PreLex ? nextToken() : getToken();
 }
 
 TreeNode* parse(void) {
 
-	yyparse();
+	/* Scan the whole source up front. */
+	if (PreLex) {
+		phaseBegin(ScanP);
+		lexSource(source);
+		phaseEnd(ScanP);
+	}
+	if (Streaming)
+		streamBegin();
+	if (Parser == DescentE)
+		savedTree = rdParse();
+	else {
+		savedTree = NULL;
+		declErrors = 0;
+		yyparse();
+	}
+	/* rdParse reads the token array again. */
+	if (Parser == CheckE)
+		crossCheck(savedTree, stderr);
+	diagFlush(listing);
 	return savedTree;
 }
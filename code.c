@@ -0,0 +1,487 @@
+/*
+	File: code.c
+	TM Code emitting utilities
+	implementation for the C-Minus compiler
+*/
+
+#include "globals.h"
+#include "util.h"
+#include "code.h"
+
+int Peephole = TRUE;
+int PeepholeReport = FALSE;
+
+/* TM opcodes, in the classes of the machine:
+ * register only, register to memory, register to address. */
+typedef enum {
+	opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV, opRRLim,
+	opLD, opST, opRMLim,
+	opLDA, opLDC, opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE, opRALim,
+	/* an instruction removed, or a location never emitted */
+	opNone
+} OpCode;
+
+static const char* opName[] = {
+	"HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "????",
+	"LD", "ST", "????",
+	"LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "????"
+};
+
+/* Marks of the temporaries saved by emitPush and emitPop. */
+#define PUSH 1
+#define POP 2
+
+/* An emitted instruction, kept until codeFlush. */
+typedef struct InstrRec {
+	OpCode op;
+	int r;
+	int s;
+	int t;
+	int d;
+	/* code location referred to by a pc relative offset, or
+	 * loaded into pc by LDC, -1 if none. Kept absolute so
+	 * that instructions can be removed. */
+	int target;
+	int flags;
+	/* source line the instruction was generated for. */
+	int lineno;
+	char* comment;
+	/* comment lines emitted before the instruction. */
+	char* before;
+} Instr;
+
+static Instr* buf = NULL;
+static int cap = 0;
+
+/* TM location number for current instruction emission */
+static int emitLoc = 0;
+
+/* Highest TM location emitted so far
+   For use in conjunction with emitSkip,
+   emitBackup, and emitRestore */
+static int highEmitLoc = 0;
+
+/* Comment lines waiting for the next new instruction. */
+static char* pending = NULL;
+
+/* Source line of the instructions emitted next. */
+static int srcLine = 0;
+
+/* Peephole rules. */
+typedef enum {StoreLoadR, LoadStoreR, PushPopR, ThreadR,
+	JumpNextR, DeadR, NopR, RULE_CNT} Rule;
+
+static const char* ruleName[RULE_CNT] = {"store-load", "load-store",
+	"push-pop", "jump-thread", "jump-next", "dead-code", "nop"};
+
+static long applied[RULE_CNT];
+static long removed[RULE_CNT];
+static long emitted = 0;
+static long written = 0;
+
+/* Instructions searched from a push for its pop. */
+#define PUSH_WINDOW 8
+/* Jumps followed by jump threading. */
+#define THREAD_HOPS 16
+
+static void* allocate (size_t n) {
+
+	void* p = calloc(1, n ? n : 1);
+
+	if (p == NULL) {
+		fprintf(stderr, "Out of memory for code\n");
+		exit(1);
+	}
+	return p;
+}
+
+static OpCode opcode (char* op) {
+
+	int i;
+
+	for (i = 0; i < opRALim; i++)
+		if (strcmp(opName[i], op) == 0)
+			return (OpCode) i;
+	fprintf(stderr, "Unknown TM opcode %s\n", op);
+	exit(1);
+}
+
+/* Function at returns the instruction at loc,
+ * growing the buffer as needed. */
+static Instr* at (int loc) {
+
+	int i;
+
+	if (loc >= cap) {
+		int old = cap;
+		cap = cap ? cap * 2 : 1024;
+		while (loc >= cap)
+			cap *= 2;
+		buf = (Instr*) realloc(buf, cap * sizeof(Instr));
+		if (buf == NULL) {
+			fprintf(stderr, "Out of memory for code\n");
+			exit(1);
+		}
+		for (i = old; i < cap; i++) {
+			memset(&buf[i], 0, sizeof(Instr));
+			buf[i].op = opNone;
+			buf[i].target = -1;
+		}
+	}
+	return &buf[loc];
+}
+
+/* Procedure attach gives the pending comment lines
+ * to the instruction at loc, if it is a new one. */
+static void attach (int loc) {
+
+	if (pending == NULL || loc < highEmitLoc)
+		return;
+	at(loc)->before = pending;
+	pending = NULL;
+}
+
+static Instr* emit (OpCode op, int r, int s, int t, int d, char* c) {
+
+	Instr* i;
+
+	attach(emitLoc);
+	i = at(emitLoc);
+	/* a backpatched one keeps the line it was skipped at */
+	if (emitLoc >= highEmitLoc)
+		i->lineno = srcLine;
+	i->op = op;
+	i->r = r;
+	i->s = s;
+	i->t = t;
+	i->d = d;
+	i->target = -1;
+	i->flags = 0;
+	free(i->comment);
+	i->comment = TraceCode && c != NULL ? copyString(c) : NULL;
+	emitLoc++;
+	if (highEmitLoc < emitLoc)
+		highEmitLoc = emitLoc;
+	return i;
+}
+
+void emitComment (char* c) {
+
+	size_t n;
+
+	if (!TraceCode)
+		return;
+	n = pending ? strlen(pending) : 0;
+	pending = (char*) realloc(pending, n + strlen(c) + 4);
+	if (pending == NULL) {
+		fprintf(stderr, "Out of memory for code\n");
+		exit(1);
+	}
+	sprintf(pending + n, "* %s\n", c);
+}
+
+void emitRO (char* op, int r, int s, int t, char* c) {
+
+	emit(opcode(op), r, s, t, 0, c);
+}
+
+void emitRM (char* op, int r, int d, int s, char* c) {
+
+	int loc = emitLoc;
+	Instr* i = emit(opcode(op), r, s, 0, d, c);
+
+	if (i->op == opLDC && r == pc)
+		i->target = d;
+	else if (i->op != opLDC && s == pc)
+		i->target = loc + 1 + d;
+}
+
+void emitPush (int r, int d, char* c) {
+
+	emit(opST, r, fp, 0, d, c)->flags = PUSH;
+}
+
+void emitPop (int r, int d, char* c) {
+
+	emit(opLD, r, fp, 0, d, c)->flags = POP;
+}
+
+void emitSource (int lineno) {
+
+	srcLine = lineno;
+}
+
+int emitSkip (int howMany) {
+
+	int i = emitLoc, k;
+
+	if (howMany > 0) {
+		attach(emitLoc);
+		at(emitLoc + howMany - 1);
+		for (k = emitLoc; k < emitLoc + howMany; k++)
+			if (k >= highEmitLoc)
+				buf[k].lineno = srcLine;
+	}
+	emitLoc += howMany;
+	if (highEmitLoc < emitLoc)
+		highEmitLoc = emitLoc;
+	return i;
+}
+
+void emitBackup (int loc) {
+
+	if (loc > highEmitLoc)
+		emitComment("BUG in emitBackup");
+	emitLoc = loc;
+}
+
+void emitRestore (void) {
+
+	emitLoc = highEmitLoc;
+}
+
+void emitRM_Abs (char* op, int r, int a, char* c) {
+
+	emitRM(op, r, a - (emitLoc + 1), pc, c);
+}
+
+static int writes (Instr* i, int reg) {
+
+	switch (i->op) {
+		case opIN: case opADD: case opSUB: case opMUL: case opDIV:
+		case opLD: case opLDA: case opLDC:
+			return i->r == reg;
+		default:
+			return FALSE;
+	}
+}
+
+static int reads (Instr* i, int reg) {
+
+	switch (i->op) {
+		case opADD: case opSUB: case opMUL: case opDIV:
+			return i->s == reg || i->t == reg;
+		case opOUT:
+			return i->r == reg;
+		case opLD: case opLDA:
+			return i->s == reg;
+		case opST:
+			return i->r == reg || i->s == reg;
+		case opJLT: case opJLE: case opJGT: case opJGE: case opJEQ: case opJNE:
+			return i->r == reg || reg == pc;
+		default:
+			return FALSE;
+	}
+}
+
+static int isBranch (Instr* i) {
+
+	return i->op >= opJLT && i->op <= opJNE;
+}
+
+/* A jump within the code, conditional or not. */
+static int isJump (Instr* i) {
+
+	return i->target >= 0 && (isBranch(i) || (i->op == opLDA && i->r == pc));
+}
+
+static int isGoto (Instr* i) {
+
+	return i->op == opLDA && i->r == pc && i->s == pc;
+}
+
+/* Control never falls through to the next instruction. */
+static int isUnconditional (Instr* i) {
+
+	return i->op == opHALT || ((i->op == opLD || i->op == opLDA
+			|| i->op == opLDC) && i->r == pc);
+}
+
+static void drop (int loc, Rule r) {
+
+	buf[loc].op = opNone;
+	applied[r]++;
+	removed[r]++;
+}
+
+/* Procedure pushPop keeps the value saved by the push at
+ * loc in the register its pop loads, when nothing between
+ * them jumps, is jumped to or uses that register.
+ */
+static int pushPop (int loc, int n, char* target) {
+
+	Instr* p = &buf[loc];
+	int k, j, cnt = 0, pop = -1;
+
+	for (k = loc + 1; k < n && cnt < PUSH_WINDOW && pop < 0; k++) {
+		Instr* i = &buf[k];
+		if (i->op == opNone)
+			continue;
+		cnt++;
+		if (target[k] || writes(i, pc) || isBranch(i) || writes(i, fp))
+			return FALSE;
+		if (i->op == opLD && (i->flags & POP) && i->s == fp && i->d == p->d)
+			pop = k;
+		/* The temporary itself, seen other than by its pop. */
+		else if ((i->op == opLD || i->op == opST) && i->s == fp && i->d == p->d)
+			return FALSE;
+	}
+	if (pop < 0)
+		return FALSE;
+	for (j = loc + 1; j < pop; j++)
+		if (buf[j].op != opNone
+				&& (writes(&buf[j], buf[pop].r) || reads(&buf[j], buf[pop].r)))
+			return FALSE;
+	p->op = opLDA;
+	p->s = p->r;
+	p->r = buf[pop].r;
+	p->d = 0;
+	p->flags = 0;
+	drop(pop, PushPopR);
+	return TRUE;
+}
+
+/* Procedure optimize applies the peephole rules to
+ * the n instructions until none of them applies.
+ */
+static void optimize (int n) {
+
+	int* next = (int*) allocate((n + 1) * sizeof(int));
+	char* target = (char*) allocate(n + 1);
+	int changed = TRUE, i, j, k;
+
+	while (changed) {
+		changed = FALSE;
+		/* next live instruction, and those jumped to */
+		next[n] = n;
+		for (i = n - 1; i >= 0; i--)
+			next[i] = buf[i].op != opNone ? i : next[i + 1];
+		memset(target, 0, n + 1);
+		for (i = 0; i < n; i++)
+			if (buf[i].op != opNone && buf[i].target >= 0 && buf[i].target <= n)
+				target[next[buf[i].target]] = TRUE;
+
+		for (i = 0; i < n; i++) {
+			Instr* a = &buf[i];
+			if (a->op == opNone)
+				continue;
+			for (j = i + 1; j < n && buf[j].op == opNone; j++)
+				;
+			if (a->op == opLDA && a->r == a->s && a->d == 0 && a->r != pc) {
+				drop(i, NopR);
+				changed = TRUE;
+				continue;
+			}
+			if (isJump(a)) {
+				int t = next[a->target], hops = 0;
+				while (t < n && isGoto(&buf[t]) && next[buf[t].target] != t
+						&& hops++ < THREAD_HOPS)
+					t = next[buf[t].target];
+				if (t != next[a->target]) {
+					a->target = t;
+					applied[ThreadR]++;
+					changed = TRUE;
+				}
+				if (t == j) {
+					drop(i, JumpNextR);
+					continue;
+				}
+			}
+			if (isUnconditional(a))
+				for (k = j; k < n && !target[k]; k++)
+					if (buf[k].op != opNone) {
+						drop(k, DeadR);
+						changed = TRUE;
+					}
+			if (j >= n || target[j] || buf[j].op == opNone)
+				continue;
+			if (a->op == opST && buf[j].op == opLD && a->r == buf[j].r
+					&& a->d == buf[j].d && a->s == buf[j].s && a->r != a->s) {
+				drop(j, StoreLoadR);
+				changed = TRUE;
+			}
+			else if (a->op == opLD && buf[j].op == opST && a->r == buf[j].r
+					&& a->d == buf[j].d && a->s == buf[j].s && a->r != a->s) {
+				drop(j, LoadStoreR);
+				changed = TRUE;
+			}
+			else if ((a->flags & PUSH) && pushPop(i, n, target))
+				changed = TRUE;
+		}
+	}
+	free(next);
+	free(target);
+}
+
+void codeFlush (FILE* out) {
+
+	int n = highEmitLoc, i, loc = 0, line = 0;
+	int* addr = (int*) allocate((n + 1) * sizeof(int));
+
+	for (i = 0; i < n; i++)
+		if (buf[i].op != opNone)
+			emitted++;
+	if (Peephole)
+		optimize(n);
+
+	/* new locations, a removed one is that of the next */
+	for (i = 0; i < n; i++) {
+		addr[i] = loc;
+		if (buf[i].op != opNone)
+			loc++;
+	}
+	addr[n] = loc;
+	written += loc;
+
+	for (i = 0; i < n; i++) {
+		Instr* a = &buf[i];
+		if (a->before)
+			fputs(a->before, out);
+		if (a->op != opNone) {
+			int d = a->d;
+			if (a->lineno > 0 && a->lineno != line) {
+				line = a->lineno;
+				fprintf(out, "* line %d\n", line);
+			}
+			if (a->target >= 0 && a->op == opLDC)
+				d = addr[a->target];
+			else if (a->target >= 0)
+				d = addr[a->target] - (addr[i] + 1);
+			if (a->op < opRRLim)
+				fprintf(out, "%3d:  %5s  %d,%d,%d ", addr[i], opName[a->op],
+						a->r, a->s, a->t);
+			else
+				fprintf(out, "%3d:  %5s  %d,%d(%d) ", addr[i], opName[a->op],
+						a->r, d, a->s);
+			if (a->comment)
+				fprintf(out, "\t%s", a->comment);
+			fprintf(out, "\n");
+		}
+		free(a->comment);
+		free(a->before);
+	}
+	if (pending)
+		fputs(pending, out);
+
+	free(pending);
+	free(buf);
+	free(addr);
+	pending = NULL;
+	buf = NULL;
+	cap = emitLoc = highEmitLoc = srcLine = 0;
+}
+
+void printPeepholeReport (FILE* out) {
+
+	int i;
+	long total = 0;
+
+	fprintf(out, "\nPeephole report:\n");
+	fprintf(out, "  %-14s%10s%10s\n", "rule", "applied", "removed");
+	for (i = 0; i < RULE_CNT; i++) {
+		fprintf(out, "  %-14s%10ld%10ld\n", ruleName[i], applied[i], removed[i]);
+		total += removed[i];
+	}
+	fprintf(out, "  %ld instructions emitted, %ld written, %ld removed (%.1f%%)\n",
+			emitted, written, total, emitted ? 100.0 * total / emitted : 0.0);
+}
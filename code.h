@@ -0,0 +1,107 @@
+/*
+	File: code.h
+	Code emitting utilities for the C-Minus compiler
+	and interface to the TM machine
+*/
+
+#ifndef _CODE_H_
+#define _CODE_H_
+
+/* pc = program counter */
+#define pc 7
+
+/* fp = frame pointer, points to the control link
+ * of the running function, its locals lie below it */
+#define fp 6
+
+/* gp = global pointer, the globals start at 0 */
+#define gp 5
+
+/* accumulators */
+#define ac 0
+#define ac1 1
+
+/* Rewrite the emitted code with the peephole rules. */
+extern int Peephole;
+/* Print what each peephole rule removed to stderr. */
+extern int PeepholeReport;
+
+/* Procedure emitComment prints a comment line
+ * with comment c in the code file
+ */
+void emitComment (char* c);
+
+/* Procedure emitRO emits a register-only
+ * TM instruction
+ * op = the opcode
+ * r = target register
+ * s = 1st source register
+ * t = 2nd source register
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRO (char* op, int r, int s, int t, char* c);
+
+/* Procedure emitRM emits a register-to-memory
+ * TM instruction
+ * op = the opcode
+ * r = target register
+ * d = the offset
+ * s = the base register
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRM (char* op, int r, int d, int s, char* c);
+
+/* Procedures emitPush and emitPop save register r in
+ * the temporary at d(fp) and load it back. A pair is
+ * marked so the peephole rules can keep the value in
+ * a register instead.
+ */
+void emitPush (int r, int d, char* c);
+void emitPop (int r, int d, char* c);
+
+/* Procedure emitSource sets the source line of the
+ * instructions emitted next. codeFlush writes a
+ * "* line N" comment where the line changes, which
+ * the simulator reads for its profile.
+ */
+void emitSource (int lineno);
+
+/* Function emitSkip skips "howMany" code
+ * locations for later backpatch. It also
+ * returns the current code position
+ */
+int emitSkip (int howMany);
+
+/* Procedure emitBackup backs up to
+ * loc = a previously skipped location
+ */
+void emitBackup (int loc);
+
+/* Procedure emitRestore restores the current
+ * code position to the highest previously
+ * unemitted position
+ */
+void emitRestore (void);
+
+/* Procedure emitRM_Abs converts an absolute reference
+ * to a pc-relative reference when emitting a
+ * register-to-memory TM instruction
+ * op = the opcode
+ * r = target register
+ * a = the absolute location in memory
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRM_Abs (char* op, int r, int a, char* c);
+
+/* Procedure codeFlush applies the peephole rules to
+ * the emitted instructions until none applies, then
+ * writes them to out with their jumps relocated.
+ */
+void codeFlush (FILE* out);
+
+/* Procedure printPeepholeReport prints the instructions
+ * each rule removed and the code size before and after.
+ */
+void printPeepholeReport (FILE* out);
+
+#endif
@@ -0,0 +1,471 @@
+#include "globals.h"
+#include "symtab.h"
+#include "diag.h"
+#include "cfg.h"
+#include "dataflow.h"
+
+int Dataflow = FALSE;
+
+/* What the evaluation of a node does to the variables,
+ * in evaluation order. */
+typedef enum {UseE, DefE, UndefE, CallE} EventKind;
+
+typedef struct EventRec {
+	EventKind kind;
+	/* variable, and definition number of DefE and UndefE. */
+	int var;
+	int def;
+	TreeNode* node;
+} Event;
+
+/* Events of the blocks of the function analyzed. */
+typedef struct EventListRec {
+	Event* ev;
+	int n;
+	int cap;
+} EventList;
+
+static Cfg* g;
+static EventList* events;
+static int defs;
+
+/* Totals over the functions analyzed. */
+static long functions = 0;
+static long blocks = 0;
+static long visits = 0;
+static long uninitialized = 0;
+static long deadStores = 0;
+static long liveAcrossCalls = 0;
+/* problems too large to solve. */
+static long skipped = 0;
+
+static int count (Word w) {
+
+	int n = 0;
+
+	for (; w; w &= w - 1)
+		n++;
+	return n;
+}
+
+static void* allocate (size_t n) {
+
+	void* p = calloc(1, n ? n : 1);
+
+	if (p == NULL) {
+		fprintf(stderr, "Out of memory for dataflow analysis\n");
+		exit(1);
+	}
+	return p;
+}
+
+Flow* flowNew (Cfg* g, int bits, int backward, int intersect) {
+
+	Flow* f;
+	Word** sets[4];
+	Word* words;
+	int i, j;
+
+	if ((long) g->nblocks * ((bits + WORD_BITS - 1) / WORD_BITS) > MAX_FLOW_WORDS / 4) {
+		skipped++;
+		return NULL;
+	}
+	f = (Flow*) allocate(sizeof(Flow));
+	f->g = g;
+	f->bits = bits;
+	f->words = (bits + WORD_BITS - 1) / WORD_BITS;
+	f->backward = backward;
+	f->intersect = intersect;
+	sets[0] = f->gen = (Word**) allocate(4 * g->nblocks * sizeof(Word*));
+	sets[1] = f->kill = f->gen + g->nblocks;
+	sets[2] = f->in = f->kill + g->nblocks;
+	sets[3] = f->out = f->in + g->nblocks;
+	words = (Word*) allocate((size_t) 4 * g->nblocks * f->words * sizeof(Word));
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < g->nblocks; j++)
+			sets[i][j] = words + ((size_t) i * g->nblocks + j) * f->words;
+	return f;
+}
+
+void flowFree (Flow* f) {
+
+	free(f->gen[0]);
+	free(f->gen);
+	free(f);
+}
+
+/* Procedure order lists the blocks in depth first
+ * postorder along the direction of flow, from its
+ * start, then the blocks not reached from there.
+ */
+static void order (Flow* f, int* list) {
+
+	int* stack = (int*) allocate(f->g->nblocks * sizeof(int));
+	int* edge = (int*) allocate(f->g->nblocks * sizeof(int));
+	char* seen = (char*) allocate(f->g->nblocks);
+	int sp = 0, n = 0, b, start;
+
+	for (start = 0; start < f->g->nblocks; start++) {
+		b = start == 0 ? (f->backward ? CFG_EXIT : CFG_ENTRY)
+			: start == 1 ? (f->backward ? CFG_ENTRY : CFG_EXIT) : start;
+		if (seen[b])
+			continue;
+		seen[b] = TRUE;
+		stack[sp++] = b;
+		edge[b] = 0;
+		while (sp > 0) {
+			Block* bl = &f->g->blocks[stack[sp - 1]];
+			int cnt = f->backward ? bl->npreds : bl->nsuccs;
+			int* next = f->backward ? bl->preds : bl->succs;
+			if (edge[stack[sp - 1]] < cnt) {
+				b = next[edge[stack[sp - 1]]++];
+				if (!seen[b]) {
+					seen[b] = TRUE;
+					edge[b] = 0;
+					stack[sp++] = b;
+				}
+			}
+			else
+				list[n++] = stack[--sp];
+		}
+	}
+	free(stack);
+	free(edge);
+	free(seen);
+}
+
+void flowSolve (Flow* f) {
+
+	int nb = f->g->nblocks;
+	int* rpo = (int*) allocate(nb * sizeof(int));
+	char* queued = (char*) allocate(nb);
+	int cnt = nb, i, j, w;
+	Word* tmp = (Word*) allocate(f->words * sizeof(Word) + 1);
+
+	/* Reverse postorder visits a block after the
+	 * blocks flowing into it, loops aside. */
+	order(f, rpo);
+	for (i = 0; i < nb / 2; i++) {
+		int t = rpo[i];
+		rpo[i] = rpo[nb - 1 - i];
+		rpo[nb - 1 - i] = t;
+	}
+	for (i = 0; i < nb; i++) {
+		queued[i] = TRUE;
+		if (f->intersect)
+			memset(f->out[i], 0xff, f->words * sizeof(Word));
+	}
+
+	/* The worklist is swept in that order, so a change
+	 * travels down the graph in one sweep and each loop
+	 * costs a sweep more, instead of a visit per block
+	 * queued ahead of it. */
+	while (cnt > 0)
+		for (i = 0; i < nb; i++) {
+			int b = rpo[i];
+			Block* bl = &f->g->blocks[b];
+			int nmeet = f->backward ? bl->nsuccs : bl->npreds;
+			int* meet = f->backward ? bl->succs : bl->preds;
+			int nnext = f->backward ? bl->npreds : bl->nsuccs;
+			int* next = f->backward ? bl->preds : bl->succs;
+			int changed = FALSE;
+
+			if (!queued[b])
+				continue;
+			queued[b] = FALSE;
+			cnt--;
+			visits++;
+			if (nmeet > 0) {
+				memcpy(f->in[b], f->out[meet[0]], f->words * sizeof(Word));
+				for (j = 1; j < nmeet; j++)
+					for (w = 0; w < f->words; w++)
+						if (f->intersect)
+							f->in[b][w] &= f->out[meet[j]][w];
+						else
+							f->in[b][w] |= f->out[meet[j]][w];
+			}
+			for (w = 0; w < f->words; w++) {
+				tmp[w] = f->gen[b][w] | (f->in[b][w] & ~f->kill[b][w]);
+				if (tmp[w] != f->out[b][w])
+					changed = TRUE;
+			}
+			if (!changed)
+				continue;
+			memcpy(f->out[b], tmp, f->words * sizeof(Word));
+			for (j = 0; j < nnext; j++)
+				if (!queued[next[j]]) {
+					queued[next[j]] = TRUE;
+					cnt++;
+				}
+		}
+	free(rpo);
+	free(queued);
+	free(tmp);
+}
+
+static void addEvent (int b, EventKind kind, int var, TreeNode* t) {
+
+	EventList* l = &events[b];
+
+	if (l->n == l->cap) {
+		l->cap = l->cap ? l->cap * 2 : 8;
+		l->ev = (Event*) realloc(l->ev, l->cap * sizeof(Event));
+		if (l->ev == NULL) {
+			fprintf(stderr, "Out of memory for dataflow analysis\n");
+			exit(1);
+		}
+	}
+	l->ev[l->n].kind = kind;
+	l->ev[l->n].var = var;
+	l->ev[l->n].def = kind == DefE || kind == UndefE ? defs++ : -1;
+	l->ev[l->n].node = t;
+	l->n++;
+}
+
+/* Procedure expEvents lists the events of expression t
+ * in block b. Operands are evaluated left to right.
+ */
+static void expEvents (int b, TreeNode* t) {
+
+	TreeNode* arg;
+	int v;
+
+	if (t == NULL || t->nodekind != ExpK)
+		return;
+	switch (t->kind.exp) {
+		case ConstK:
+			break;
+		case IdK:
+			expEvents(b, t->child[0]);
+			if ((v = cfgVar(g, t)) >= 0)
+				addEvent(b, UseE, v, t);
+			break;
+		case CallK:
+			for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+				expEvents(b, arg);
+			addEvent(b, CallE, -1, t);
+			break;
+		case OpK:
+			if (t->attr.op == ASSIGN) {
+				if (t->child[0] != NULL)
+					expEvents(b, t->child[0]->child[0]);
+				expEvents(b, t->child[1]);
+				if ((v = cfgVar(g, t->child[0])) >= 0)
+					addEvent(b, DefE, v, t);
+				break;
+			}
+			expEvents(b, t->child[0]);
+			expEvents(b, t->child[1]);
+			break;
+	}
+}
+
+static void blockEvents (int b) {
+
+	Block* bl = &g->blocks[b];
+	TreeNode* t;
+	int i, v;
+
+	for (i = 0; i < bl->nnodes; i++) {
+		t = bl->nodes[i];
+		if (t->nodekind == DeclK) {
+			if ((v = cfgVar(g, t)) >= 0)
+				addEvent(b, UndefE, v, t);
+		}
+		else if (t->nodekind == StmtK)
+			expEvents(b, t->child[0]);
+		else
+			expEvents(b, t);
+	}
+}
+
+static void warn (TreeNode* t, const char* msg, int var) {
+
+	diagReport(t->lineno, WarningS, SemanticC, msg, g->vars[var]->name);
+}
+
+/* Procedure liveness finds the stores whose value is
+ * never read and the values live across calls.
+ */
+static void liveness (char* reached) {
+
+	Flow* f = flowNew(g, g->nvars, TRUE, FALSE);
+	Word* live;
+	int b, i, w;
+
+	if (f == NULL)
+		return;
+	live = (Word*) allocate(f->words * sizeof(Word) + 1);
+	for (b = 0; b < g->nblocks; b++)
+		for (i = 0; i < events[b].n; i++) {
+			Event* e = &events[b].ev[i];
+			if (e->kind == UseE && !BIT_TEST(f->kill[b], e->var))
+				BIT_SET(f->gen[b], e->var);
+			else if (e->kind == DefE || e->kind == UndefE)
+				BIT_SET(f->kill[b], e->var);
+		}
+	flowSolve(f);
+
+	for (b = 0; b < g->nblocks; b++) {
+		if (!reached[b])
+			continue;
+		memcpy(live, f->in[b], f->words * sizeof(Word));
+		for (i = events[b].n - 1; i >= 0; i--) {
+			Event* e = &events[b].ev[i];
+			switch (e->kind) {
+				case DefE:
+					if (!BIT_TEST(live, e->var)) {
+						warn(e->node, "Assigned value is never used.", e->var);
+						deadStores++;
+					}
+					BIT_CLEAR(live, e->var);
+					break;
+				case UndefE:
+					BIT_CLEAR(live, e->var);
+					break;
+				case UseE:
+					BIT_SET(live, e->var);
+					break;
+				case CallE:
+					for (w = 0; w < f->words; w++)
+						liveAcrossCalls += count(live[w]);
+					break;
+			}
+		}
+	}
+	free(live);
+	flowFree(f);
+}
+
+/* Procedure reaching finds the uses of locals reached
+ * by their declaration, before any assignment.
+ */
+static void reaching (char* reached) {
+
+	Flow* f = flowNew(g, defs, FALSE, FALSE);
+	int words, b, i, w;
+	Word* sets, * undef, * reach;
+
+	if (f == NULL)
+		return;
+	words = f->words;
+	/* definitions of each variable, and the declarations. */
+	sets = (Word*) allocate(((size_t) g->nvars + 2) * words * sizeof(Word));
+	undef = sets + (size_t) g->nvars * words;
+	reach = undef + words;
+
+	for (b = 0; b < g->nblocks; b++)
+		for (i = 0; i < events[b].n; i++) {
+			Event* e = &events[b].ev[i];
+			if (e->def < 0)
+				continue;
+			BIT_SET(sets + (size_t) e->var * words, e->def);
+			if (e->kind == UndefE)
+				BIT_SET(undef, e->def);
+		}
+	for (b = 0; b < g->nblocks; b++)
+		for (i = 0; i < events[b].n; i++) {
+			Event* e = &events[b].ev[i];
+			Word* of;
+			if (e->def < 0)
+				continue;
+			of = sets + (size_t) e->var * words;
+			for (w = 0; w < words; w++) {
+				f->kill[b][w] |= of[w];
+				f->gen[b][w] &= ~of[w];
+			}
+			BIT_SET(f->gen[b], e->def);
+		}
+	flowSolve(f);
+
+	for (b = 0; b < g->nblocks; b++) {
+		if (!reached[b])
+			continue;
+		memcpy(reach, f->in[b], words * sizeof(Word));
+		for (i = 0; i < events[b].n; i++) {
+			Event* e = &events[b].ev[i];
+			Word* of = sets + (size_t) (e->var < 0 ? 0 : e->var) * words;
+			if (e->kind == UseE) {
+				for (w = 0; w < words; w++)
+					if (reach[w] & of[w] & undef[w])
+						break;
+				if (w < words) {
+					warn(e->node, "Variable may be used before assignment.", e->var);
+					uninitialized++;
+				}
+			}
+			else if (e->kind != CallE) {
+				for (w = 0; w < words; w++)
+					reach[w] &= ~of[w];
+				BIT_SET(reach, e->def);
+			}
+		}
+	}
+	free(sets);
+	flowFree(f);
+}
+
+/* Procedure reach marks the blocks reached from the entry. */
+static void reach (char* reached) {
+
+	int* stack = (int*) allocate(g->nblocks * sizeof(int));
+	int sp = 0, b, i;
+
+	reached[CFG_ENTRY] = TRUE;
+	stack[sp++] = CFG_ENTRY;
+	while (sp > 0) {
+		b = stack[--sp];
+		for (i = 0; i < g->blocks[b].nsuccs; i++)
+			if (!reached[g->blocks[b].succs[i]]) {
+				reached[g->blocks[b].succs[i]] = TRUE;
+				stack[sp++] = g->blocks[b].succs[i];
+			}
+	}
+	free(stack);
+}
+
+void dataflowDeclaration (TreeNode* t) {
+
+	char* reached;
+	int b;
+
+	g = cfgBuild(t);
+	if (g == NULL)
+		return;
+	functions++;
+	blocks += g->nblocks;
+	events = (EventList*) allocate(g->nblocks * sizeof(EventList));
+	defs = 0;
+	for (b = 0; b < g->nblocks; b++)
+		blockEvents(b);
+	/* Findings in unreachable code are not reported. */
+	reached = (char*) allocate(g->nblocks);
+	reach(reached);
+
+	liveness(reached);
+	reaching(reached);
+
+	for (b = 0; b < g->nblocks; b++)
+		free(events[b].ev);
+	free(events);
+	free(reached);
+	cfgFree(g);
+	g = NULL;
+}
+
+void dataflowCheck (TreeNode* syntaxTree) {
+
+	TreeNode* t;
+
+	for (t = syntaxTree; t != NULL; t = t->sibling)
+		dataflowDeclaration(t);
+}
+
+void printDataflowReport (FILE* out) {
+
+	fprintf(out, "Dataflow: %ld functions, %ld blocks, %ld block visits, "
+			"%ld uses before assignment, %ld dead stores, "
+			"%ld values live across calls, %ld problems too large\n",
+			functions, blocks, visits, uninitialized, deadStores,
+			liveAcrossCalls, skipped);
+}
@@ -0,0 +1,72 @@
+#ifndef _DATAFLOW_H_
+#define _DATAFLOW_H_
+
+/* Run liveness and reaching definitions after type checking. */
+extern int Dataflow;
+
+/* Bit vector sets, an array of words each. */
+typedef unsigned long Word;
+#define WORD_BITS (8 * (int) sizeof(Word))
+#define BIT_SET(s, i) ((s)[(i) / WORD_BITS] |= 1UL << ((i) % WORD_BITS))
+#define BIT_CLEAR(s, i) ((s)[(i) / WORD_BITS] &= ~(1UL << ((i) % WORD_BITS)))
+#define BIT_TEST(s, i) (((s)[(i) / WORD_BITS] >> ((i) % WORD_BITS)) & 1)
+
+/* A dataflow problem over the blocks of a control flow
+ * graph, solved for out = gen | (in & ~kill) in each
+ * block, where in meets the out sets of its neighbours.
+ */
+typedef struct FlowRec {
+
+	Cfg* g;
+	int bits;
+	int words;
+	/* TRUE if facts flow from successors to predecessors,
+	 * then in is the set at the end of a block. */
+	int backward;
+	/* TRUE to meet by intersection instead of union. */
+	int intersect;
+	/* sets per block; in of a block without neighbours
+	 * to meet, as the entry, is left as the caller set it. */
+	Word** gen;
+	Word** kill;
+	Word** in;
+	Word** out;
+} Flow;
+
+/* Function flowNew allocates the empty sets of a
+ * problem on g, with the given number of bits.
+ * It returns NULL if they would take more than
+ * MAX_FLOW_WORDS words: the sets grow with the square
+ * of the function size for reaching definitions.
+ */
+#define MAX_FLOW_WORDS (1L << 24)
+
+Flow* flowNew (Cfg* g, int bits, int backward, int intersect);
+
+/* Procedure flowSolve computes in and out of every
+ * block from gen and kill with a worklist, visiting
+ * blocks in depth first order of the direction of flow.
+ */
+void flowSolve (Flow* f);
+
+void flowFree (Flow* f);
+
+/* Procedure dataflowDeclaration runs liveness and reaching
+ * definitions on a function declaration. It warns of
+ * locals that may be used before they are assigned and
+ * of values assigned and never used, and counts the
+ * values live across calls.
+ */
+void dataflowDeclaration (TreeNode* t);
+
+/* Procedure dataflowCheck analyzes every
+ * function of the syntax tree.
+ */
+void dataflowCheck (TreeNode* syntaxTree);
+
+/* Procedure printDataflowReport prints the sizes of
+ * the graphs, the solver work and the findings.
+ */
+void printDataflowReport (FILE* out);
+
+#endif
@@ -0,0 +1,151 @@
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "dce.h"
+
+/* Removed declarations in source order. */
+static TreeNode** removed = NULL;
+static int removedCnt = 0;
+static int removedCap = 0;
+/* AST nodes of the declarations kept and removed. */
+static long liveNodes = 0;
+static long deadNodes = 0;
+/* Declarations seen, by kind. */
+static int funcCnt = 0, varCnt = 0;
+
+/* Function countNodes counts the nodes of a subtree,
+ * without the siblings of t.
+ */
+static long countNodes (TreeNode* t) {
+
+	long n = 0;
+	int i;
+	if (t == NULL)
+		return 0;
+	n = 1;
+	for (i = 0; i < MAXCHILDREN; i++) {
+		TreeNode* c;
+		for (c = t->child[i]; c; c = c->sibling)
+			n += countNodes(c);
+	}
+	return n;
+}
+
+/* Function isDead returns TRUE if the top level 
+ * declaration t was not reached from main. 
+ * Declarations without a record, such as duplicates,
+ * are kept so their diagnostics are not lost.
+ */
+static int isDead (TreeNode* t) {
+
+	if (t->nodekind != DeclK || t->sym == NULL)
+		return FALSE;
+	return (t->kind.decl == FunK || t->kind.decl == VarK) 
+		&& !t->sym->live;
+}
+
+int markReachable (TreeNode* syntaxTree) {
+
+	TreeNode* t;
+	TreeNode* mainDecl = NULL;
+	int* work;
+	int i, wp = 0;
+
+	for (t = syntaxTree; t; t = t->sibling)
+		if (t->nodekind == DeclK && t->kind.decl == FunK 
+				&& t->sym && strcmp(t->attr.name, "main") == 0)
+			mainDecl = t;
+	if (mainDecl == NULL || mainDecl->sym->sig == NULL
+			|| mainDecl->sym->sig->fid < 0)
+		return FALSE;
+
+	/* Breadth first over the call edges. */
+	work = (int*) malloc((callGraphSize + 1) * sizeof(int));
+	work[wp++] = mainDecl->sym->sig->fid;
+	mainDecl->sym->live = TRUE;
+	for (i = 0; i < wp; i++) {
+		CallNodeRec* n = &callGraph[work[i]];
+		int j;
+		for (j = 0; j < n->nuses; j++)
+			n->uses[j]->live = TRUE;
+		for (j = 0; j < n->ncallees; j++) {
+			CallNodeRec* c = &callGraph[n->callees[j]];
+			if (!c->fn->live) {
+				c->fn->live = TRUE;
+				work[wp++] = n->callees[j];
+			}
+		}
+	}
+	free(work);
+	return TRUE;
+}
+
+TreeNode* removeDead (TreeNode* syntaxTree) {
+
+	TreeNode* t;
+	TreeNode* head = NULL;
+	TreeNode* tail = NULL;
+
+	for (t = syntaxTree; t; ) {
+		TreeNode* next = t->sibling;
+		long n = countNodes(t);
+		if (t->nodekind == DeclK && t->kind.decl == FunK)
+			funcCnt++;
+		else if (t->nodekind == DeclK && t->kind.decl == VarK)
+			varCnt++;
+		if (isDead(t)) {
+			/* Symbol records still point into the subtree, 
+			 * so it is unlinked but not freed. */
+			if (removedCnt == removedCap) {
+				removedCap = removedCap ? removedCap * 2 : 16;
+				removed = (TreeNode**) realloc(removed, 
+						removedCap * sizeof(TreeNode*));
+			}
+			removed[removedCnt++] = t;
+			t->sibling = NULL;
+			deadNodes += n;
+		}
+		else {
+			if (tail)
+				tail->sibling = t;
+			else
+				head = t;
+			tail = t;
+			liveNodes += n;
+		}
+		t = next;
+	}
+	if (tail)
+		tail->sibling = NULL;
+	return head;
+}
+
+void printDeadReport (FILE* out, double checkTime, int deadChecked) {
+
+	int i, deadFuncs = 0, deadVars = 0;
+	long total = liveNodes + deadNodes;
+	double saved;
+
+	fprintf(out, "\nDead code elimination:\n");
+	for (i = 0; i < removedCnt; i++) {
+		TreeNode* t = removed[i];
+		if (t->kind.decl == FunK)
+			deadFuncs++;
+		else
+			deadVars++;
+		fprintf(out, "  removed %s %s (line %d)\n", 
+				t->kind.decl == FunK ? "function" : "variable",
+				t->attr.name, t->lineno);
+	}
+	fprintf(out, "  kept %d of %d functions, %d of %d global variables\n",
+			funcCnt - deadFuncs, funcCnt, varCnt - deadVars, varCnt);
+	fprintf(out, "  removed %ld of %ld nodes (%.1f%%)\n", deadNodes, total,
+			total ? 100.0 * deadNodes / total : 0.0);
+	/* typeCheck time is about linear in the nodes visited. */
+	if (deadChecked)
+		saved = total ? checkTime * deadNodes / total : 0.0;
+	else
+		saved = liveNodes ? checkTime * deadNodes / liveNodes : 0.0;
+	fprintf(out, "  typeCheck %.6f s, %s %.6f s\n", checkTime,
+			deadChecked ? "dead code took about" : "estimated saving", saved);
+}
@@ -0,0 +1,22 @@
+#ifndef _DCE_H_
+#define _DCE_H_
+
+/* Function markReachable marks the functions and 
+ * global variables reachable from main through the 
+ * call graph. Returns FALSE if there is no main function.
+ */
+int markReachable (TreeNode* syntaxTree);
+
+/* Function removeDead unlinks the unreachable function
+ * and global variable declarations from the syntax tree
+ * and returns the new tree.
+ */
+TreeNode* removeDead (TreeNode* syntaxTree);
+
+/* Procedure printDeadReport lists the removed declarations.
+ * checkTime is the wall time of typeCheck, deadChecked is
+ * TRUE if the removed declarations were checked too.
+ */
+void printDeadReport (FILE* out, double checkTime, int deadChecked);
+
+#endif
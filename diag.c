@@ -0,0 +1,219 @@
+#include "globals.h"
+#include "diag.h"
+
+int MaxErrors = 0;
+int DiagJSON = FALSE;
+
+/* Pending diagnostics. */
+static DiagList pending;
+
+/* Capturing list of the calling thread. */
+static __thread DiagList* capture = NULL;
+
+/* Errors reported so far. */
+static int errorCnt = 0;
+/* Syntax errors among them. */
+static int syntaxCnt = 0;
+/* Next report order. */
+static long seq = 0;
+/* The cutoff message is written only once. */
+static int cutoffShown = FALSE;
+
+/* Function append adds a record to l. */
+static DiagRec* append (DiagList* l) {
+
+	if (l->cnt == l->cap) {
+		l->cap = l->cap ? l->cap * 2 : 64;
+		l->recs = (DiagRec*) realloc(l->recs, l->cap * sizeof(DiagRec));
+		if (l->recs == NULL) {
+			fprintf(stderr, "Out of memory for diagnostics\n");
+			exit(1);
+		}
+	}
+	return &l->recs[l->cnt++];
+}
+
+/* Procedure record records a diagnostic. */
+static void record (int lineno, Severity sev, Category cat, 
+		const char* msg, const char* detail, const char* name) {
+
+	DiagRec* d;
+	if (capture == NULL && sev == ErrorS) {
+		Error = TRUE;
+		if (diagFull())
+			return;
+		errorCnt++;
+		if (cat == SyntaxC)
+			syntaxCnt++;
+	}
+	d = append(capture ? capture : &pending);
+	d->lineno = lineno;
+	d->sev = sev;
+	d->cat = cat;
+	d->msg = msg;
+	d->name = name;
+	d->detail = NULL;
+	if (detail) {
+		d->detail = (char*) malloc(strlen(detail) + 1);
+		if (d->detail)
+			strcpy(d->detail, detail);
+	}
+	/* replay numbers captured records. */
+	d->seq = capture ? 0 : seq++;
+}
+
+void diagReport (int lineno, Severity sev, Category cat, 
+		const char* msg, const char* detail) {
+
+	record(lineno, sev, cat, msg, detail, NULL);
+}
+
+void diagReportName (int lineno, Severity sev, Category cat, 
+		const char* msg, const char* name) {
+
+	record(lineno, sev, cat, msg, NULL, name);
+}
+
+void diagCapture (DiagList* l) {
+
+	capture = l;
+}
+
+void diagReplay (DiagList* l) {
+
+	int i;
+	for (i = 0; i < l->cnt; i++) {
+		DiagRec* d = &l->recs[i];
+		/* a serial traversal would have stopped here. */
+		if (!diagFull())
+			record(d->lineno, d->sev, d->cat, d->msg, d->detail, d->name);
+		free(d->detail);
+	}
+	free(l->recs);
+	l->recs = NULL;
+	l->cnt = l->cap = 0;
+}
+
+void diagDiscard (DiagList* l) {
+
+	int i;
+	for (i = 0; i < l->cnt; i++)
+		free(l->recs[i].detail);
+	free(l->recs);
+	l->recs = NULL;
+	l->cnt = l->cap = 0;
+}
+
+int diagFull (void) {
+
+	return MaxErrors > 0 && errorCnt >= MaxErrors;
+}
+
+int diagSyntaxErrors (void) {
+
+	return syntaxCnt;
+}
+
+static int compareDiag (const void* a, const void* b) {
+
+	const DiagRec* x = (const DiagRec*) a;
+	const DiagRec* y = (const DiagRec*) b;
+	if (x->lineno != y->lineno)
+		return x->lineno < y->lineno ? -1 : 1;
+	return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+static int sameDiag (DiagRec* x, DiagRec* y) {
+
+	return x->lineno == y->lineno && x->sev == y->sev && x->cat == y->cat
+		&& strcmp(x->msg, y->msg) == 0 && x->name == y->name
+		&& (x->detail == y->detail 
+			|| (x->detail && y->detail && strcmp(x->detail, y->detail) == 0));
+}
+
+/* Function isDuplicate returns TRUE if an earlier record 
+ * on the same line of the sorted diagnostics equals pending.recs[i].
+ */
+static int isDuplicate (int i) {
+
+	int j;
+	for (j = i - 1; j >= 0 && pending.recs[j].lineno == pending.recs[i].lineno; j--)
+		if (sameDiag(&pending.recs[j], &pending.recs[i]))
+			return TRUE;
+	return FALSE;
+}
+
+/* Procedure printJSONString writes s as a JSON string. */
+static void printJSONString (FILE* out, const char* s) {
+
+	fputc('"', out);
+	for (; *s; s++) {
+		switch (*s) {
+			case '"': fputs("\\\"", out); break;
+			case '\\': fputs("\\\\", out); break;
+			case '\n': fputs("\\n", out); break;
+			case '\t': fputs("\\t", out); break;
+			default:
+				if ((unsigned char) *s < 0x20)
+					fprintf(out, "\\u%04x", *s);
+				else
+					fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void printDiag (FILE* out, DiagRec* d) {
+
+	static const char* catName[] = {"syntax", "symbol", "semantic"};
+	if (DiagJSON) {
+		fprintf(out, "{\"line\": %d, \"severity\": \"%s\", \"category\": \"%s\", \"message\": ",
+			d->lineno, d->sev == ErrorS ? "error" : "warning", catName[d->cat]);
+		printJSONString(out, d->msg);
+		if (d->name) {
+			fprintf(out, ", \"name\": ");
+			printJSONString(out, d->name);
+		}
+		if (d->detail) {
+			fprintf(out, ", \"detail\": ");
+			printJSONString(out, d->detail);
+		}
+		fprintf(out, "}\n");
+		return;
+	}
+	if (d->sev == WarningS)
+		fprintf(out, "Warning at line %d: %s\n", d->lineno, d->msg);
+	else switch (d->cat) {
+		case SyntaxC: 
+			fprintf(out, "Syntax error at line %d: %s\n", d->lineno, d->msg); break;
+		case SymbolC: 
+			fprintf(out, "Symbolic error at line %d: %s\n", d->lineno, d->msg); break;
+		case SemanticC: 
+			fprintf(out, "Semantic error at line %d: %s\n", d->lineno, d->msg); break;
+	}
+	if (d->detail)
+		fprintf(out, "%s\n", d->detail);
+}
+
+void diagFlush (FILE* out) {
+
+	int i;
+	if (pending.cnt > 1)
+		qsort(pending.recs, pending.cnt, sizeof(DiagRec), compareDiag);
+	for (i = 0; i < pending.cnt; i++) {
+		if (!isDuplicate(i))
+			printDiag(out, &pending.recs[i]);
+	}
+	for (i = 0; i < pending.cnt; i++)
+		free(pending.recs[i].detail);
+	pending.cnt = 0;
+
+	if (diagFull() && !cutoffShown) {
+		cutoffShown = TRUE;
+		if (DiagJSON)
+			fprintf(out, "{\"severity\": \"fatal\", \"message\": \"too many errors\", \"limit\": %d}\n", 
+				MaxErrors);
+		else
+			fprintf(out, "Too many errors, stopped after %d.\n", MaxErrors);
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef _DIAG_H_
+#define _DIAG_H_
+
+typedef enum {ErrorS, WarningS} Severity;
+typedef enum {SyntaxC, SymbolC, SemanticC} Category;
+
+/* A diagnostic of the input source code. */
+typedef struct DiagRec {
+
+	int lineno;
+	Severity sev;
+	Category cat;
+	/* constant message text. */
+	const char* msg;
+	/* optional second line, owned by the record. */
+	char* detail;
+	/* optional interned name the diagnostic is about,
+	 * not printed as text but told apart by it. */
+	const char* name;
+	/* report order, keeps sorting stable. */
+	long seq;
+} DiagRec;
+
+/* Diagnostics captured by a worker thread. */
+typedef struct DiagListRec {
+
+	DiagRec* recs;
+	int cnt;
+	int cap;
+} DiagList;
+
+/* Stop after this many errors, 0 for no limit. */
+extern int MaxErrors;
+/* Emit diagnostics as JSON lines instead of text. */
+extern int DiagJSON;
+
+/* Procedure diagReport records a diagnostic.
+ * Errors set the Error flag.
+ */
+void diagReport (int lineno, Severity sev, Category cat, 
+		const char* msg, const char* detail);
+
+/* Procedure diagReportName records a diagnostic about
+ * a name, so that the same message about two names of
+ * a line is not dropped as a duplicate.
+ */
+void diagReportName (int lineno, Severity sev, Category cat, 
+		const char* msg, const char* name);
+
+/* Function diagFull returns TRUE once MaxErrors
+ * errors have been reported, after which 
+ * the traversals stop early.
+ */
+int diagFull (void);
+
+/* Function diagSyntaxErrors returns the number
+ * of syntax errors reported so far.
+ */
+int diagSyntaxErrors (void);
+
+/* Procedure diagCapture redirects the diagnostics 
+ * reported by the calling thread into l, without 
+ * counting them. NULL restores normal reporting.
+ */
+void diagCapture (DiagList* l);
+
+/* Procedure diagReplay reports the captured diagnostics 
+ * of l in order, as if they were reported now, 
+ * and empties l.
+ */
+void diagReplay (DiagList* l);
+
+/* Procedure diagDiscard drops the captured 
+ * diagnostics of l without reporting them.
+ */
+void diagDiscard (DiagList* l);
+
+/* Procedure diagFlush sorts the recorded diagnostics 
+ * by line, drops duplicates and writes them out.
+ */
+void diagFlush (FILE* out);
+
+#endif
@@ -0,0 +1,52 @@
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "frame.h"
+
+int FrameReport = FALSE;
+
+/* The slot at -4 is reserved, locals start below it. */
+#define FRAME_TOP (-4)
+
+void frameLayout (TreeNode* t) {
+
+	CallNodeRec* n;
+	int i, low = FRAME_TOP;
+
+	if (t->sym == NULL || t->sym->sig == NULL 
+			|| t->sym->sig->fid < 0 || t->scope == NULL)
+		return;
+	n = &callGraph[t->sym->sig->fid];
+	n->unshared = 0;
+	/* The scopes of the body follow the function scope. */
+	for (i = t->scope->id; i < scope_index; i++) {
+		ScopeList sc = scope[i];
+		int start = sc->level == 1 ? FRAME_TOP : sc->parent->varLoc;
+		n->unshared += start - sc->varLoc;
+		if (sc->varLoc < low)
+			low = sc->varLoc;
+	}
+	n->frame = FRAME_TOP - low;
+}
+
+void printFrameReport (FILE* out) {
+
+	int i, funcs = 0;
+	long frames = 0, saved = 0;
+
+	fprintf(out, "\nFrame report:\n");
+	fprintf(out, "  %-16s%8s%8s%10s%8s\n", 
+			"function", "params", "locals", "unshared", "saved");
+	for (i = 0; i < callGraphSize; i++) {
+		CallNodeRec* n = &callGraph[i];
+		if (n->frame < 0)
+			continue;
+		fprintf(out, "  %-16s%8d%8d%10d%8d\n", n->fn->name, 
+				n->params, n->frame, n->unshared, n->unshared - n->frame);
+		funcs++;
+		frames += n->frame;
+		saved += n->unshared - n->frame;
+	}
+	fprintf(out, "  %d functions, %ld bytes of locals, %ld bytes saved\n",
+			funcs, frames, saved);
+}
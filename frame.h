@@ -0,0 +1,21 @@
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+/* Print the frame report to stderr. */
+extern int FrameReport;
+
+/* Procedure frameLayout records the frame size of the
+ * function declared by t in its call graph node, once
+ * its scopes are complete. Each block starts its locals
+ * at the offset its parent ends at, so sibling blocks
+ * share slots and the frame is the deepest block path.
+ */
+void frameLayout (TreeNode* t);
+
+/* Procedure printFrameReport prints the parameter and
+ * local bytes of every function, with the bytes saved 
+ * by sharing slots between sibling blocks.
+ */
+void printFrameReport (FILE* out);
+
+#endif
@@ -58,13 +58,31 @@ typedef struct treeNode {
 	} attr;
 	ExpType type;
 	int len;
+	int flags;
+	/* symbol table record, set by buildSymtab on
+	 * declarations and on IdK and CallK references. */
+	struct BucketListRec* sym;
+	/* scope opened by a FunK or CompoundK node, 
+	 * set by buildSymtab. */
+	struct ScopeListRec* scope;
 } TreeNode;
 
+/* Node flags. */
+/* a syntax error was recovered inside the node. */
+#define PARTIAL 1
+/* an array access whose index is proven in bounds. */
+#define IN_BOUNDS 2
+/* a counted while loop without loop carried dependences. */
+#define VECTOR_LOOP 4
+
 extern int EchoSource;
 extern int TraceScan;
 extern int TraceParse;
 extern int TraceAnalyze;
 extern int TraceCode;
+extern int TimeReport;
+/* Compile a unit without main, its functions are called from others. */
+extern int LibraryUnit;
 extern int Error;
 
 #endif
@@ -0,0 +1,309 @@
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "iface.h"
+#include "util.h"
+
+#define IFACE_MAGIC "cminus-interface 1"
+
+/* Registered interface files. */
+static char** imports = NULL;
+static int importCnt = 0;
+
+static const char* typeName[] = {"void", "int", "array"};
+
+/* A symbol read from an interface file. */
+typedef struct IfaceSymRec {
+
+	int def;
+	char VPF;
+	char* name;
+	int type;
+	int loc;
+	/* array length of a variable. */
+	int len;
+	Signature sig;
+	/* interface file and line it was read from. */
+	char* file;
+	int line;
+	/* read order, keeps sorting stable. */
+	int seq;
+} IfaceSym;
+
+static int typeOf (char* s) {
+
+	int i;
+	if (strcmp(s, "any") == 0)
+		return ANY_TYPE;
+	for (i = 0; i < 3; i++)
+		if (strcmp(s, typeName[i]) == 0)
+			return i;
+	return -1;
+}
+
+static const char* nameOfType (int type) {
+
+	return type == ANY_TYPE ? "any" : typeName[type];
+}
+
+/* Function readSymbol parses one line of an interface file.
+ * Returns FALSE on a malformed line.
+ */
+static int readSymbol (char* line, IfaceSym* s) {
+
+	char* tok[4];
+	char* p;
+	int i;
+	for (i = 0; i < 4; i++) {
+		tok[i] = strtok(i ? NULL : line, " \t\n");
+		if (tok[i] == NULL)
+			return FALSE;
+	}
+	s->def = strcmp(tok[0], "def") == 0;
+	if (!s->def && strcmp(tok[0], "use") != 0)
+		return FALSE;
+	s->VPF = tok[1][0];
+	s->name = tok[2];
+	s->type = typeOf(tok[3]);
+	s->sig = NULL;
+	s->len = 0;
+	if ((p = strtok(NULL, " \t\n")) == NULL)
+		return FALSE;
+	s->loc = atoi(p);
+	if ((p = strtok(NULL, " \t\n")) == NULL)
+		return FALSE;
+	if (s->VPF == 'V')
+		s->len = atoi(p);
+	else if (s->VPF == 'F') {
+		int arity = atoi(p);
+		if (arity < 0)
+			return FALSE;
+		s->sig = st_newSignature(arity);
+		for (i = 0; i < arity; i++) {
+			if ((p = strtok(NULL, " \t\n")) == NULL || typeOf(p) < 0) {
+				free(s->sig);
+				return FALSE;
+			}
+			s->sig->types[i] = typeOf(p);
+		}
+	}
+	else
+		return FALSE;
+	if (s->type < 0 || s->type == ANY_TYPE) {
+		free(s->sig);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Function forEachSymbol reads an interface file and 
+ * applies proc to every symbol. Returns FALSE if the 
+ * file can't be read or is malformed.
+ */
+static int forEachSymbol (char* file, void (* proc) (IfaceSym*)) {
+
+	FILE* in = fopen(file, "r");
+	char* line = NULL;
+	size_t cap = 0;
+	int lno = 0, ok = TRUE;
+	IfaceSym s;
+
+	if (in == NULL) {
+		fprintf(stderr, "Unable to open %s\n", file);
+		return FALSE;
+	}
+	while (getline(&line, &cap, in) > 0) {
+		lno++;
+		if (lno == 1) {
+			if (strncmp(line, IFACE_MAGIC, strlen(IFACE_MAGIC)) != 0) {
+				fprintf(stderr, "%s: not an interface file\n", file);
+				ok = FALSE;
+				break;
+			}
+			continue;
+		}
+		if (line[0] == '\n' || line[0] == '#')
+			continue;
+		if (!readSymbol(line, &s)) {
+			fprintf(stderr, "%s:%d: malformed interface line\n", file, lno);
+			ok = FALSE;
+			break;
+		}
+		s.file = file;
+		s.line = lno;
+		proc(&s);
+	}
+	free(line);
+	fclose(in);
+	return ok;
+}
+
+void addImport (char* name) {
+
+	imports = (char**) realloc(imports, (importCnt + 1) * sizeof(char*));
+	imports[importCnt++] = name;
+}
+
+/* Procedure importSymbol declares a symbol defined by
+ * another unit. Its uses there are checked at link time.
+ * Its location is in the other unit, so here it is
+ * external, at -1 like the intrinsics.
+ */
+static void importSymbol (IfaceSym* s) {
+
+	BucketList l;
+	if (!s->def) {
+		free(s->sig);
+		return;
+	}
+	l = st_declare(st_intern(s->name), 0, -1, s->VPF, 
+			s->type, s->len, NULL);
+	if (l == NULL) {
+		fprintf(stderr, "%s:%d: duplicate imported declaration of %s\n",
+				s->file, s->line, s->name);
+		Error = TRUE;
+		free(s->sig);
+		return;
+	}
+	l->imported = TRUE;
+	if (s->VPF == 'F') {
+		l->sig = s->sig;
+		cg_addFunction(l, NULL);
+	}
+}
+
+void importInterfaces (void) {
+
+	int i;
+	for (i = 0; i < importCnt; i++)
+		if (!forEachSymbol(imports[i], importSymbol))
+			exit(1);
+}
+
+void emitInterface (FILE* out) {
+
+	BucketList l;
+	int i;
+	outOpen(out);
+	outStr(IFACE_MAGIC "\n");
+	for (l = scope[0]->first; l != NULL; l = l->nextInScope) {
+		/* Every unit has the intrinsics. */
+		if ((l->VPF != 'F' && l->VPF != 'V') || l->intrinsic != NO_INTRINSIC)
+			continue;
+		/* Functions with syntax errors have no signature. */
+		if (l->VPF == 'F' && l->sig == NULL)
+			continue;
+		outStr(l->imported ? "use " : "def ");
+		outChar(l->VPF);
+		outChar(' ');
+		outStr(l->name);
+		outChar(' ');
+		outStr(nameOfType(l->type));
+		outChar(' ');
+		outInt(l->memloc, 0);
+		outChar(' ');
+		if (l->VPF == 'V')
+			outInt(l->len, 0);
+		else {
+			outInt(l->sig->arity, 0);
+			for (i = 0; i < l->sig->arity; i++) {
+				outChar(' ');
+				outStr(nameOfType(l->sig->types[i]));
+			}
+		}
+		outChar('\n');
+	}
+	outFlush();
+}
+
+/* Symbols of all linked units, definitions and uses. */
+static IfaceSym* linkSyms = NULL;
+static int linkCnt = 0;
+static int linkCap = 0;
+
+static void collectSymbol (IfaceSym* s) {
+
+	if (linkCnt == linkCap) {
+		linkCap = linkCap ? linkCap * 2 : 64;
+		linkSyms = (IfaceSym*) realloc(linkSyms, linkCap * sizeof(IfaceSym));
+	}
+	linkSyms[linkCnt] = *s;
+	linkSyms[linkCnt].name = st_intern(s->name);
+	linkSyms[linkCnt].seq = linkCnt;
+	linkCnt++;
+}
+
+/* Function sameType compares a use with its definition. */
+static int sameType (IfaceSym* use, IfaceSym* def) {
+
+	int i;
+	if (use->VPF != def->VPF || use->type != def->type)
+		return FALSE;
+	if (use->VPF == 'V')
+		return use->len == def->len;
+	if (use->sig->arity != def->sig->arity)
+		return FALSE;
+	for (i = 0; i < use->sig->arity; i++)
+		if (use->sig->types[i] != def->sig->types[i])
+			return FALSE;
+	return TRUE;
+}
+
+/* Function compareSym orders symbols by name, 
+ * definitions first, then in read order. 
+ */
+static int compareSym (const void* a, const void* b) {
+
+	const IfaceSym* x = (const IfaceSym*) a;
+	const IfaceSym* y = (const IfaceSym*) b;
+	int c = strcmp(x->name, y->name);
+	if (c != 0)
+		return c;
+	if (x->def != y->def)
+		return y->def - x->def;
+	return x->seq - y->seq;
+}
+
+int linkInterfaces (int n, char** files, FILE* out) {
+
+	int i, j, errors = 0, defs = 0, mains = 0;
+
+	for (i = 0; i < n; i++)
+		if (!forEachSymbol(files[i], collectSymbol))
+			return 1;
+	if (linkCnt > 1)
+		qsort(linkSyms, linkCnt, sizeof(IfaceSym), compareSym);
+
+	for (i = 0; i < linkCnt; i = j) {
+		IfaceSym* def = linkSyms[i].def ? &linkSyms[i] : NULL;
+		for (j = i; j < linkCnt && linkSyms[j].name == linkSyms[i].name; j++) {
+			IfaceSym* s = &linkSyms[j];
+			if (s == def)
+				continue;
+			if (s->def)
+				fprintf(out, "Link error: %s defined in %s and %s\n",
+						s->name, def->file, s->file);
+			else if (def == NULL)
+				fprintf(out, "Link error: %s used in %s is not defined\n",
+						s->name, s->file);
+			else if (!sameType(s, def))
+				fprintf(out, "Link error: %s used in %s does not match its definition in %s\n",
+						s->name, s->file, def->file);
+			else
+				continue;
+			errors++;
+		}
+		if (def) {
+			defs++;
+			if (strcmp(def->name, "main") == 0)
+				mains++;
+		}
+	}
+	if (mains == 0) {
+		fprintf(out, "Link error: There does not exist main function.\n");
+		errors++;
+	}
+	if (errors == 0)
+		fprintf(out, "Link finished: %d units, %d symbols\n", n, defs);
+	return errors;
+}
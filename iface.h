@@ -0,0 +1,35 @@
+#ifndef _IFACE_H_
+#define _IFACE_H_
+
+/* Interface files describe the global scope of a unit,
+ * one symbol per line:
+ *	def F <name> <type> <loc> <arity> <param types...>
+ *	def V <name> <type> <loc> <len>
+ * Symbols imported from other units are written 
+ * the same way with "use" instead of "def", so the 
+ * link step can check them against their definitions.
+ */
+
+/* Procedure addImport registers an interface file 
+ * to be imported by buildSymtab.
+ */
+void addImport (char* name);
+
+/* Procedure importInterfaces declares the symbols
+ * of the registered interfaces in the current scope.
+ */
+void importInterfaces (void);
+
+/* Procedure emitInterface writes the global scope 
+ * as an interface file.
+ */
+void emitInterface (FILE* out);
+
+/* Function linkInterfaces checks that the interfaces
+ * of the units of a program agree: every symbol defined
+ * once, every use defined with the same type, and one main.
+ * Returns the number of link errors.
+ */
+int linkInterfaces (int n, char** files, FILE* out);
+
+#endif
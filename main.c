@@ -7,9 +7,26 @@
 
 #define NO_PARSE FALSE
 #define NO_ANALYZE FALSE
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
+#include "stats.h"
+#include "symtab.h"
+#include "diag.h"
+#include "callgraph.h"
+#include "dce.h"
+#include "iface.h"
+#include "tokens.h"
+#include "stream.h"
+#include "frame.h"
+#include "stack.h"
+#include "bounds.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "vector.h"
+#include "code.h"
+#include "sim.h"
+#include "server.h"
 
 #if NO_PARSE
 #include "scan.h"
@@ -36,21 +53,225 @@ int TraceScan = FALSE;
 int TraceParse = FALSE;
 int TraceAnalyze = TRUE;
 int TraceCode = FALSE;
+/* Print phase timings and counters to stderr. */
+int TimeReport = FALSE;
+static int TimeReportJSON = FALSE;
+int LibraryUnit = FALSE;
+/* Print symbol table hash statistics to stderr. */
+static int HashStats = FALSE;
+/* Export the symbol table as JSON to this file, "-" for stdout. */
+static char* SymtabJSON = NULL;
+/* Export the call graph as JSON to this file, "-" for stdout. */
+static char* CallGraphJSON = NULL;
+/* Remove declarations unreachable from main before type checking. */
+static int DeadCode = FALSE;
+/* Type check the unreachable declarations before removing them. */
+static int DeadCodeDiags = FALSE;
+/* Write the global scope as an interface file. */
+static char* InterfaceFile = NULL;
+/* Compiling a request of the compile server. */
+static int Serving = FALSE;
 
 int Error = FALSE;
 
-int main (int argc, char* argv[]) {
+/* Procedure exportFile writes an export 
+ * produced by printProc to the named file.
+ */
+static void exportFile (char* name, void (* printProc) (FILE*)) {
+
+	FILE* out = strcmp(name, "-") ? fopen(name, "w") : stdout;
+	if (out == NULL) {
+		fprintf(stderr, "Unable to open %s\n", name);
+		exit(1);
+	}
+	phaseBegin(PrintP);
+	printProc(out);
+	phaseEnd(PrintP);
+	if (out != stdout)
+		fclose(out);
+}
+
+static void usage (char* prog) {
+
+	fprintf(stderr, "usage: %s [options] <filename>\n", prog);
+	fprintf(stderr, "       %s --link <interface> ...\n", prog);
+	fprintf(stderr, "       %s --server[=unix:PATH] [--server-jobs=N]\n", prog);
+	fprintf(stderr, "options:\n");
+	fprintf(stderr, "  --time-report[=json]  print phase timings and counters to stderr\n");
+	fprintf(stderr, "  --hash-stats          print symbol table hash statistics to stderr\n");
+	fprintf(stderr, "  --symtab-json=FILE    export the symbol table as JSON (- for stdout)\n");
+	fprintf(stderr, "  --callgraph=FILE      export the call graph as JSON (- for stdout)\n");
+	fprintf(stderr, "  --max-errors=N        stop after N errors\n");
+	fprintf(stderr, "  --lookup=shadow       resolve names through per-name shadow stacks\n");
+	fprintf(stderr, "  --diag=json           print diagnostics as JSON lines\n");
+	fprintf(stderr, "  --frame-report        print the frame size of every function to stderr\n");
+	fprintf(stderr, "  --stack-report        print the worst case stack of every function to stderr\n");
+	fprintf(stderr, "  --bounds              prove array indices in bounds, warn of those out\n");
+	fprintf(stderr, "  --dataflow            warn of uninitialized uses and dead stores by liveness\n");
+	fprintf(stderr, "  --vectorize           strip mine counted loops over arrays by %d\n", VECTOR_WIDTH);
+	fprintf(stderr, "  --no-peephole         write the generated code without the peephole rules\n");
+	fprintf(stderr, "  --peephole-report     print what the peephole rules removed to stderr\n");
+	fprintf(stderr, "  --trace-code          write comments to the generated code\n");
+	fprintf(stderr, "  --run                 run the generated code on the TM simulator\n");
+	fprintf(stderr, "  --profile             with --run, print the cost of every source line\n");
+	fprintf(stderr, "  --run-steps=N         with --run, stop after N instructions (default %ld)\n",
+			DEFAULT_RUN_STEPS);
+	fprintf(stderr, "  --dce                 remove functions and globals unreachable from main\n");
+	fprintf(stderr, "  --dce-keep-diags      type check unreachable code before removing it\n");
+	fprintf(stderr, "  --jobs=N              type check function bodies on N threads\n");
+	fprintf(stderr, "  --prelex              scan the whole source before parsing\n");
+	fprintf(stderr, "  --scan-jobs=N         prelex the source in chunks on N threads (0 for getToken)\n");
+	fprintf(stderr, "  --parser=rd|bison     parse by recursive descent or with bison\n");
+	fprintf(stderr, "  --parser=check        parse with both and compare the trees\n");
+	fprintf(stderr, "  --trace-scan          list the tokens as they are scanned\n");
+	fprintf(stderr, "  --stream              analyze and free each declaration once it is parsed\n");
+	fprintf(stderr, "  --lib                 compile a unit without main\n");
+	fprintf(stderr, "  --import=FILE         declare the globals of another unit from its interface\n");
+	fprintf(stderr, "  --emit-interface=FILE write the global scope as an interface file\n");
+	fprintf(stderr, "  --server[=unix:PATH]  compile the requests read from stdin or a socket\n");
+	fprintf(stderr, "  --server-jobs=N       compile up to N requests of a client at a time\n");
+	exit(1);
+}
+
+/* Procedure warmUp prepares the server before it forks
+ * the requests: the names every unit has are interned, so
+ * the requests inherit them. The server compiles nothing,
+ * its compiler state is not resettable, so nothing more
+ * is shared; touching heap pages here only made every
+ * request pay for copying them on write.
+ */
+static void warmUp (void) {
+
+	st_intern("main");
+	st_intern("input");
+	st_intern("output");
+}
+
+/* Function compile compiles the file named by the options in
+ * argv, or the program text unless it is NULL. A server request
+ * returns TRUE if it had errors, and both return 1 if --run
+ * did not end at HALT.
+ */
+static int compile (int argc, char* argv[], char* text, size_t len) {
 	TreeNode* syntaxTree;
 	char pgm[120]; /* file name. */
-	if (argc != 2) {
-		fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-		exit(1);
+	char* file = NULL;
+	char* serverPath = NULL;
+	int server = FALSE;
+	int genCode;
+	int status = 0;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--time-report") == 0)
+			TimeReport = TRUE;
+		else if (strcmp(argv[i], "--time-report=json") == 0)
+			TimeReport = TimeReportJSON = TRUE;
+		else if (strcmp(argv[i], "--hash-stats") == 0)
+			HashStats = TRUE;
+		else if (strncmp(argv[i], "--symtab-json=", 14) == 0)
+			SymtabJSON = argv[i] + 14;
+		else if (strncmp(argv[i], "--callgraph=", 12) == 0)
+			CallGraphJSON = argv[i] + 12;
+		else if (strncmp(argv[i], "--max-errors=", 13) == 0)
+			MaxErrors = atoi(argv[i] + 13);
+		else if (strcmp(argv[i], "--diag=json") == 0)
+			DiagJSON = TRUE;
+		else if (strcmp(argv[i], "--lookup=shadow") == 0)
+			ShadowStacks = TRUE;
+		else if (strcmp(argv[i], "--lookup=hash") == 0)
+			ShadowStacks = FALSE;
+		else if (strcmp(argv[i], "--frame-report") == 0)
+			FrameReport = TRUE;
+		else if (strcmp(argv[i], "--stack-report") == 0)
+			StackReport = TRUE;
+		else if (strcmp(argv[i], "--bounds") == 0)
+			BoundsCheck = TRUE;
+		else if (strcmp(argv[i], "--dataflow") == 0)
+			Dataflow = TRUE;
+		else if (strcmp(argv[i], "--vectorize") == 0)
+			Vectorize = TRUE;
+		else if (strcmp(argv[i], "--no-peephole") == 0)
+			Peephole = FALSE;
+		else if (strcmp(argv[i], "--peephole-report") == 0)
+			PeepholeReport = TRUE;
+		else if (strcmp(argv[i], "--trace-code") == 0)
+			TraceCode = TRUE;
+		else if (strcmp(argv[i], "--run") == 0)
+			RunCode = TRUE;
+		else if (strcmp(argv[i], "--profile") == 0)
+			RunCode = RunProfile = TRUE;
+		else if (strncmp(argv[i], "--run-steps=", 12) == 0)
+			RunSteps = atol(argv[i] + 12);
+		else if (strcmp(argv[i], "--dce") == 0)
+			DeadCode = TRUE;
+		else if (strcmp(argv[i], "--dce-keep-diags") == 0)
+			DeadCode = DeadCodeDiags = TRUE;
+		else if (strncmp(argv[i], "--jobs=", 7) == 0)
+			Jobs = atoi(argv[i] + 7);
+		else if (strcmp(argv[i], "--prelex") == 0)
+			PreLex = TRUE;
+		else if (strncmp(argv[i], "--scan-jobs=", 12) == 0) {
+			ScanJobs = atoi(argv[i] + 12);
+			/* 0 fills the token array through getToken. */
+			PreLex = TRUE;
+		}
+		else if (strcmp(argv[i], "--parser=rd") == 0)
+			Parser = DescentE;
+		else if (strcmp(argv[i], "--parser=bison") == 0)
+			Parser = BisonE;
+		else if (strcmp(argv[i], "--parser=check") == 0)
+			Parser = CheckE;
+		else if (strcmp(argv[i], "--trace-scan") == 0)
+			TraceScan = TRUE;
+		else if (strcmp(argv[i], "--stream") == 0)
+			Streaming = TRUE;
+		else if (strcmp(argv[i], "--lib") == 0)
+			LibraryUnit = TRUE;
+		else if (strncmp(argv[i], "--import=", 9) == 0)
+			addImport(argv[i] + 9);
+		else if (strncmp(argv[i], "--emit-interface=", 17) == 0)
+			InterfaceFile = argv[i] + 17;
+		else if (!Serving && strcmp(argv[i], "--server") == 0)
+			server = TRUE;
+		else if (!Serving && strncmp(argv[i], "--server=unix:", 14) == 0) {
+			server = TRUE;
+			serverPath = argv[i] + 14;
+		}
+		else if (!Serving && strncmp(argv[i], "--server-jobs=", 14) == 0)
+			ServerJobs = atoi(argv[i] + 14);
+		else if (!Serving && strcmp(argv[i], "--link") == 0) {
+			/* The rest are interface files of the units. */
+			if (i + 1 >= argc)
+				usage(argv[0]);
+			return linkInterfaces(argc - i - 1, argv + i + 1, stdout) ? 1 : 0;
+		}
+		else if (argv[i][0] == '-' || file != NULL)
+			usage(argv[0]);
+		else
+			file = argv[i];
+	}
+	if (server) {
+		if (file != NULL)
+			usage(argv[0]);
+		Serving = TRUE;
+		warmUp();
+		return serve(serverPath, argv[0], compile);
 	}
+	if (file == NULL || strlen(file) + 5 > sizeof(pgm))
+		usage(argv[0]);
+	/* The check parses the token array twice. */
+	if (Parser == CheckE)
+		PreLex = TRUE;
+	/* Both need the whole tree. */
+	if (Parser == CheckE || DeadCode)
+		Streaming = FALSE;
 
-	strcpy(pgm, argv[1]);
+	strcpy(pgm, file);
 	if (strchr (pgm,'.') == NULL)
 		strcat(pgm,".tny");
-	source = fopen(pgm, "r");
+	/* A program sent to the server is not written anywhere. */
+	source = text != NULL ? fmemopen(text, len, "r") : fopen(pgm, "r");
 	if (source == NULL) {
 		fprintf(stderr, "File %s not found\n", pgm);
 		exit(1);
@@ -61,25 +282,108 @@ int main (int argc, char* argv[]) {
 	fprintf(listing, "-------------------------------------------------\n");
 	while (getToken() != ENDFILE);
 #else 
+	phaseBegin(ParseP);
 	syntaxTree = parse();
+	phaseEnd(ParseP);
+	stats.lines = lineno;
 	if (TraceParse) {
 		fprintf(listing, "\nSyntax tree: \n");
 		printTree(syntaxTree);
 	}
 
 #if !NO_ANALYZE
-	if (! Error) {	
+	/* Declarations that parsed cleanly are analyzed 
+	 * even after syntax errors. */
+	if ((Streaming ? streamed > 0 : syntaxTree != NULL) && !diagFull()) {	
 		if (TraceAnalyze) fprintf(listing, "\nBuilding Synbol Table ...\n");
-		buildSymtab(syntaxTree);
-		if (TraceAnalyze) fprintf(listing, "\nChecking Types ...\n");
-		typeCheck(syntaxTree);
-		if (TraceAnalyze) fprintf(listing, "\nType Checking Finished\n");
+		phaseBegin(SymtabP);
+		if (Streaming)
+			streamSymtab();
+		else
+			buildSymtab(syntaxTree);
+		phaseEnd(SymtabP);
+		if (HashStats)
+			printHashStats(stderr);
+		if (SymtabJSON)
+			exportFile(SymtabJSON, printSymTabJSON);
+		if (CallGraphJSON)
+			exportFile(CallGraphJSON, printCallGraph);
+		if (FrameReport)
+			printFrameReport(stderr);
+		if (StackReport)
+			printStackReport(stderr);
+		/* Without a main function nothing is reachable, 
+		 * mainCheck reports it and nothing is removed. 
+		 * Calls lost to a syntax error would make live 
+		 * functions look dead, so those units keep all. */
+		if (DeadCode && diagSyntaxErrors() > 0)
+			DeadCode = FALSE;
+		if (DeadCode && !diagFull() && !markReachable(syntaxTree))
+			DeadCode = FALSE;
+		if (DeadCode && !DeadCodeDiags)
+			syntaxTree = removeDead(syntaxTree);
+		if (!diagFull()) {
+			double checkTime = wallClock();
+			if (TraceAnalyze) fprintf(listing, "\nChecking Types ...\n");
+			phaseBegin(CheckP);
+			if (Streaming)
+				streamCheck();
+			else
+				typeCheck(syntaxTree);
+			phaseEnd(CheckP);
+			checkTime = wallClock() - checkTime;
+			if (TraceAnalyze) fprintf(listing, "\nType Checking Finished\n");
+			/* The analyses assume a well typed program. */
+			if ((BoundsCheck || Dataflow || Vectorize) && !Error && !diagFull()) {
+				phaseBegin(FlowP);
+				if (Streaming)
+					streamFlow();
+				else {
+					if (BoundsCheck)
+						boundsCheck(syntaxTree);
+					if (Dataflow)
+						dataflowCheck(syntaxTree);
+					if (Vectorize)
+						vectorCheck(syntaxTree);
+				}
+				phaseEnd(FlowP);
+				diagFlush(listing);
+				if (BoundsCheck)
+					printBoundsReport(stderr);
+				if (Dataflow)
+					printDataflowReport(stderr);
+				if (Vectorize)
+					printVectorReport(stderr);
+			}
+			if (DeadCode && DeadCodeDiags)
+				syntaxTree = removeDead(syntaxTree);
+			if (DeadCode)
+				printDeadReport(stderr, checkTime, DeadCodeDiags);
+		}
+		/* Like an object file, no interface for a unit with errors. */
+		if (InterfaceFile && !Error)
+			exportFile(InterfaceFile, emitInterface);
 	}
 
 #if !NO_CODE
-	if (! Error) {
+	/* A streamed tree is freed as it goes, and a
+	 * unit without main is only checked. */
+	genCode = ! Error && ! Streaming && ! LibraryUnit && text == NULL
+			&& syntaxTree != NULL && ! diagFull();
+	/* No code can call into another unit, which is a
+	 * limit of TM and not an error of the source. */
+	if (genCode && externalCheck(syntaxTree) > 0) {
+		fprintf(stderr, "Note: %s uses symbols of other units, no code is generated\n", pgm);
+		genCode = FALSE;
+	}
+	if (genCode) {
 		char* codefile;
-		int fnlen = strcspn(pgm, ".");
+		char* base = strrchr(pgm, '/');
+		char* ext;
+		int fnlen;
+		base = base == NULL ? pgm : base + 1;
+		ext = strrchr(base, '.');
+		fnlen = ext == NULL ? strlen(pgm) : ext - pgm;
 		codefile = (char*) calloc(fnlen+4, sizeof(char));
 		strncpy(codefile, pgm, fnlen);
 		strcat(codefile, ".tm");
@@ -88,12 +392,32 @@ int main (int argc, char* argv[]) {
 			printf("Unable to open %s\n", codefile);
 			exit(1);
 		}
+		phaseBegin(CodeP);
 		codeGen(syntaxTree, codefile);
+		phaseEnd(CodeP);
 		fclose(code);
+		if (PeepholeReport)
+			printPeepholeReport(stderr);
+		if (RunCode) {
+			phaseBegin(RunP);
+			/* like a crashed program, a faulting run fails */
+			if (!runCode(codefile))
+				status = 1;
+			phaseEnd(RunP);
+			printRunReport(stderr);
+		}
+		free(codefile);
 	}
 #endif
 #endif
 #endif
 	fclose(source);
-	return 0;
+	if (TimeReport)
+		printStats(stderr, TimeReportJSON);
+	return Serving ? Error || status : status;
+}
+
+int main (int argc, char* argv[]) {
+
+	return compile(argc, argv, NULL, 0);
 }
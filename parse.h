@@ -1,4 +1,10 @@
 #ifndef _PARSE_H_
 #define _PARSE_H_
+
+/* Parser engines: the bison parser, the recursive
+ * descent parser, or bison cross checked against it. */
+typedef enum {BisonE, DescentE, CheckE} ParserKind;
+extern ParserKind Parser;
+
 TreeNode* parse(void);
 #endif
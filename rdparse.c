@@ -0,0 +1,592 @@
+#include <setjmp.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "diag.h"
+#include "stats.h"
+#include "tokens.h"
+#include "rdparse.h"
+#include "stream.h"
+
+/* Nodes are created at the points where bison
+ * reduces their rules, so they get the same lineno:
+ * the last token read, which is the lookahead only
+ * where bison needs one to decide.
+ */
+
+/* Lists keep their last node, so appending 
+ * does not walk the siblings as bison's rules do. */
+typedef struct NodeListRec {
+
+	TreeNode* head;
+	TreeNode* last;
+} NodeList;
+
+/* Current token, read only when it is looked at. */
+static TokenType token;
+static int haveToken = FALSE;
+
+/* Declarations parsed so far, kept for an aborted parse. */
+static NodeList decls;
+/* Syntax errors since the last declaration. */
+static int declErrors;
+
+/* Innermost point to recover at, a statement
+ * or a top level declaration. */
+static jmp_buf* recovery;
+static jmp_buf abortParse;
+
+static TreeNode* expression (void);
+static TreeNode* statement (void);
+
+static TokenType peek (void) {
+
+	if (!haveToken) {
+		token = PreLex ? nextToken() : getToken();
+		haveToken = TRUE;
+	}
+	return token;
+}
+
+static void advance (void) {
+
+	haveToken = FALSE;
+}
+
+/* Procedure syntaxError reports the current token
+ * as bison's yyerror does and unwinds to the
+ * innermost recovery point.
+ */
+static void syntaxError (void) {
+
+	char detail[MAXTOKENLEN + 64];
+	snprintf(detail, sizeof(detail), "Current token: \t%s\t\t%s",
+		tokenLabel(token), tokenLexeme(token, tokenString));
+	diagReport(lineno, ErrorS, SyntaxC, "syntax error", detail);
+	declErrors++;
+	longjmp(*recovery, 1);
+}
+
+static void match (TokenType expected) {
+
+	if (peek() != expected)
+		syntaxError();
+	advance();
+}
+
+/* Procedure skipPast discards tokens through the
+ * first a or b, aborting the parse at the end of file.
+ */
+static void skipPast (TokenType a, TokenType b) {
+
+	while (peek() != a && peek() != b) {
+		if (peek() == ENDFILE)
+			longjmp(abortParse, 1);
+		advance();
+	}
+	advance();
+	if (diagFull())
+		longjmp(abortParse, 1);
+}
+
+/* Procedure skipStatement discards tokens through the
+ * next semicolon, or up to the closing brace of the block.
+ */
+static void skipStatement (void) {
+
+	while (peek() != SEMI && token != RCURLY) {
+		if (token == ENDFILE)
+			longjmp(abortParse, 1);
+		advance();
+	}
+	if (token == SEMI)
+		advance();
+	if (diagFull())
+		longjmp(abortParse, 1);
+}
+
+static void append (NodeList* l, TreeNode* t) {
+
+	if (t == NULL)
+		return;
+	if (l->last == NULL)
+		l->head = t;
+	else
+		l->last->sibling = t;
+	l->last = t;
+}
+
+static TreeNode* identifier (void) {
+
+	TreeNode* t;
+	if (peek() != ID)
+		syntaxError();
+	t = newExpNode(IdK);
+	t->attr.name = tokenName();
+	advance();
+	return t;
+}
+
+static int number (void) {
+
+	int n;
+	if (peek() != NUM)
+		syntaxError();
+	n = atoi(tokenString);
+	advance();
+	return n;
+}
+
+static TreeNode* typeSpecifier (void) {
+
+	TreeNode* t;
+	if (peek() == INT) {
+		t = newTypeNode(IntK);
+		t->type = Integer;
+	}
+	else if (token == VOID) {
+		t = newTypeNode(VoidK);
+		t->type = Void;
+	}
+	else
+		syntaxError();
+	t->len = 0;
+	advance();
+	return t;
+}
+
+/* Function varDeclaration parses the rest of a
+ * variable declaration after its type and name.
+ */
+static TreeNode* varDeclaration (TreeNode* type, TreeNode* id) {
+
+	TreeNode* t;
+	if (peek() == LSQUARE) {
+		advance();
+		type->len = number();
+		type->type = Array;
+		match(RSQUARE);
+	}
+	match(SEMI);
+	t = newDeclNode(VarK);
+	t->attr.name = id->attr.name;
+	t->lineno = id->lineno;
+	t->child[0] = type;
+	return t;
+}
+
+static TreeNode* param (TreeNode* type) {
+
+	TreeNode* id = identifier();
+	TreeNode* t;
+	if (peek() == LSQUARE) {
+		advance();
+		match(RSQUARE);
+		type->type = Array;
+		type->len = 0;
+	}
+	t = newDeclNode(ParamK);
+	t->attr.name = id->attr.name;
+	t->lineno = id->lineno;
+	t->child[0] = type;
+	return t;
+}
+
+static TreeNode* params (void) {
+
+	NodeList list = {NULL, NULL};
+	TreeNode* type = NULL;
+	if (peek() == VOID) {
+		advance();
+		/* bison reads past void to tell the two apart. */
+		if (peek() == RPAREN)
+			return NULL;
+		type = newTypeNode(VoidK);
+		type->type = Void;
+		type->len = 0;
+	}
+	for (;;) {
+		if (type == NULL)
+			type = typeSpecifier();
+		append(&list, param(type));
+		if (peek() != COMMA)
+			break;
+		advance();
+		type = NULL;
+	}
+	return list.head;
+}
+
+static TreeNode* compound (void) {
+
+	NodeList locals = {NULL, NULL};
+	NodeList stmts = {NULL, NULL};
+	TreeNode* t;
+	match(LCURLY);
+	while (peek() == INT || token == VOID) {
+		TreeNode* type = typeSpecifier();
+		append(&locals, varDeclaration(type, identifier()));
+	}
+	while (peek() != RCURLY)
+		append(&stmts, statement());
+	advance();
+	t = newStmtNode(CompoundK);
+	t->child[0] = locals.head;
+	t->child[1] = stmts.head;
+	return t;
+}
+
+static TreeNode* args (void) {
+
+	NodeList list = {NULL, NULL};
+	if (peek() == RPAREN)
+		return NULL;
+	for (;;) {
+		append(&list, expression());
+		if (peek() != COMMA)
+			break;
+		advance();
+	}
+	return list.head;
+}
+
+/* Function factor sets *isVar if the factor is
+ * a var, which may be assigned to.
+ */
+static TreeNode* factor (int* isVar) {
+
+	TreeNode* t;
+	*isVar = FALSE;
+	switch (peek()) {
+		case LPAREN:
+			advance();
+			t = expression();
+			match(RPAREN);
+			return t;
+		case NUM:
+			t = newExpNode(ConstK);
+			t->attr.val = atoi(tokenString);
+			t->type = Integer;
+			advance();
+			return t;
+		case ID:
+			t = identifier();
+			if (peek() == LPAREN) {
+				TreeNode* call;
+				advance();
+				call = newExpNode(CallK);
+				call->child[0] = args();
+				match(RPAREN);
+				call->attr.name = t->attr.name;
+				call->lineno = t->lineno;
+				return call;
+			}
+			if (token == LSQUARE) {
+				advance();
+				t->child[0] = expression();
+				match(RSQUARE);
+			}
+			*isVar = TRUE;
+			return t;
+		default:
+			syntaxError();
+	}
+	return NULL;
+}
+
+/* Relational operators bind loosest and do not associate. */
+static int precedence (TokenType op) {
+
+	switch (op) {
+		case LT: case LE: case GT: case GE: case EQ: case NE:
+			return 1;
+		case PLUS: case MINUS:
+			return 2;
+		case TIMES: case OVER:
+			return 3;
+		default:
+			return 0;
+	}
+}
+
+/* Function binary parses operators of at least
+ * precedence min, left to right.
+ */
+static TreeNode* binary (int min, int* isVar) {
+
+	TreeNode* left = factor(isVar);
+	int prec, dummy;
+	while ((prec = precedence(peek())) >= min && prec > 0) {
+		TreeNode* t = newExpNode(OpK);
+		t->attr.op = token;
+		advance();
+		t->child[0] = left;
+		t->child[1] = binary(prec + 1, &dummy);
+		left = t;
+		*isVar = FALSE;
+		if (prec == 1)
+			break;
+	}
+	return left;
+}
+
+static TreeNode* expression (void) {
+
+	int isVar;
+	TreeNode* left = binary(1, &isVar);
+	TreeNode* t;
+	if (!isVar || peek() != ASSIGN)
+		return left;
+	advance();
+	t = newExpNode(OpK);
+	t->attr.op = ASSIGN;
+	t->child[0] = left;
+	t->child[1] = expression();
+	/* reduced after the lookahead past the right side. */
+	t->lineno = lineno;
+	return t;
+}
+
+static TreeNode* statementBody (void) {
+
+	TreeNode* t;
+	TreeNode* e;
+	TreeNode* s;
+	switch (peek()) {
+		case SEMI:
+			advance();
+			return NULL;
+		case LCURLY:
+			return compound();
+		case IF:
+			advance();
+			match(LPAREN);
+			e = expression();
+			match(RPAREN);
+			s = statementBody();
+			if (peek() == ELSE) {
+				advance();
+				t = newStmtNode(IfK);
+				t->child[2] = statementBody();
+				/* created after the else part, as bison does. */
+				t->lineno = lineno;
+			}
+			else
+				t = newStmtNode(IfK);
+			t->child[0] = e;
+			t->child[1] = s;
+			return t;
+		case WHILE:
+			advance();
+			match(LPAREN);
+			e = expression();
+			match(RPAREN);
+			t = newStmtNode(WhileK);
+			t->child[0] = e;
+			t->child[1] = statementBody();
+			/* created after the body, as bison does. */
+			t->lineno = lineno;
+			return t;
+		case RETURN:
+			advance();
+			e = NULL;
+			if (peek() != SEMI)
+				e = expression();
+			match(SEMI);
+			t = newStmtNode(ReturnK);
+			t->child[0] = e;
+			return t;
+		default:
+			t = expression();
+			match(SEMI);
+			return t;
+	}
+}
+
+/* Function statement parses a statement of a block's list,
+ * recovering from a syntax error anywhere in it, also in
+ * the body of an if or while, by skipping through the next
+ * semicolon or up to the closing brace, as bison's
+ * "statement_list: statement_list error SEMI" and
+ * "compound_stmt: ... error RCURLY" rules do.
+ */
+static TreeNode* statement (void) {
+
+	jmp_buf here;
+	jmp_buf* outer = recovery;
+	TreeNode* t;
+	recovery = &here;
+	if (setjmp(here)) {
+		recovery = outer;
+		skipStatement();
+		return NULL;
+	}
+	t = statementBody();
+	recovery = outer;
+	return t;
+}
+
+static TreeNode* declaration (void) {
+
+	jmp_buf here;
+	jmp_buf* outer = recovery;
+	TreeNode* type;
+	TreeNode* id;
+	TreeNode* t;
+	recovery = &here;
+	if (setjmp(here)) {
+		recovery = outer;
+		skipPast(SEMI, RCURLY);
+		declErrors = 0;
+		return NULL;
+	}
+	type = typeSpecifier();
+	id = identifier();
+	if (peek() != LPAREN) {
+		t = varDeclaration(type, id);
+		declErrors = 0;
+	}
+	else {
+		TreeNode* p;
+		advance();
+		p = params();
+		match(RPAREN);
+		t = newDeclNode(FunK);
+		t->attr.name = id->attr.name;
+		t->child[0] = type;
+		t->child[1] = p;
+		t->child[2] = compound();
+		t->lineno = id->lineno;
+		if (declErrors > 0)
+			t->flags |= PARTIAL;
+		declErrors = 0;
+	}
+	recovery = outer;
+	return t;
+}
+
+TreeNode* rdParse (void) {
+
+	decls.head = decls.last = NULL;
+	declErrors = 0;
+	haveToken = FALSE;
+	recovery = NULL;
+	if (setjmp(abortParse))
+		return decls.head;
+	/* a program has at least one declaration. */
+	do
+		if (Streaming)
+			streamDeclaration(declaration());
+		else
+			append(&decls, declaration());
+	while (peek() != ENDFILE);
+	return decls.head;
+}
+
+/* Function sameNode compares the fields the parser
+ * sets, others are left uninitialized.
+ */
+static int sameNode (TreeNode* a, TreeNode* b) {
+
+	if (a->nodekind != b->nodekind || a->lineno != b->lineno
+			|| a->flags != b->flags)
+		return FALSE;
+	switch (a->nodekind) {
+		case StmtK:
+			return a->kind.stmt == b->kind.stmt;
+		case ExpK:
+			if (a->kind.exp != b->kind.exp || a->type != b->type)
+				return FALSE;
+			if (a->kind.exp == OpK)
+				return a->attr.op == b->attr.op;
+			if (a->kind.exp == ConstK)
+				return a->attr.val == b->attr.val;
+			return strcmp(a->attr.name, b->attr.name) == 0;
+		case DeclK:
+			return a->kind.decl == b->kind.decl
+				&& strcmp(a->attr.name, b->attr.name) == 0;
+		case TypeK:
+			return a->kind.type == b->kind.type && a->type == b->type
+				&& a->len == b->len;
+	}
+	return FALSE;
+}
+
+/* Function firstDifference returns the first node of a
+ * in preorder that differs from b, or NULL if they match.
+ */
+static TreeNode* firstDifference (TreeNode* a, TreeNode* b) {
+
+	for (; a != NULL && b != NULL; a = a->sibling, b = b->sibling) {
+		TreeNode* d;
+		int i;
+		if (!sameNode(a, b))
+			return a;
+		for (i = 0; i < MAXCHILDREN; i++)
+			if ((d = firstDifference(a->child[i], b->child[i])) != NULL)
+				return d;
+	}
+	return a != NULL ? a : b;
+}
+
+/* Function treeListing prints tree with printTree
+ * into a temporary file.
+ */
+static FILE* treeListing (TreeNode* tree) {
+
+	FILE* saved = listing;
+	FILE* f = tmpfile();
+	if (f != NULL) {
+		listing = f;
+		printTree(tree);
+		listing = saved;
+		rewind(f);
+	}
+	return f;
+}
+
+static int sameListing (FILE* a, FILE* b) {
+
+	int c;
+	if (a == NULL || b == NULL)
+		return FALSE;
+	while ((c = getc(a)) == getc(b))
+		if (c == EOF)
+			return TRUE;
+	return FALSE;
+}
+
+int crossCheck (TreeNode* tree, FILE* out) {
+
+	DiagList discarded = {NULL, 0, 0};
+	int trace = TraceScan;
+	TreeNode* other;
+	TreeNode* diff;
+	FILE* a;
+	FILE* b;
+	int same;
+
+	/* The tokens are read a second time, quietly. */
+	rewindTokens();
+	TraceScan = FALSE;
+	diagCapture(&discarded);
+	other = rdParse();
+	diagCapture(NULL);
+	diagDiscard(&discarded);
+	TraceScan = trace;
+
+	a = treeListing(tree);
+	b = treeListing(other);
+	same = sameListing(a, b);
+	if (a) fclose(a);
+	if (b) fclose(b);
+	if (!same)
+		fprintf(out, "Parser check: printTree listings differ\n");
+	diff = firstDifference(tree, other);
+	if (diff != NULL)
+		fprintf(out, "Parser check: trees differ at line %d\n", diff->lineno);
+	else if (same)
+		fprintf(out, "Parser check: trees match\n");
+	return !same || diff != NULL;
+}
@@ -0,0 +1,18 @@
+#ifndef _RDPARSE_H_
+#define _RDPARSE_H_
+
+/* Function rdParse parses the source by recursive descent,
+ * with precedence climbing for the binary operators.
+ * It builds the same tree as the bison parser and
+ * recovers from syntax errors at the same points.
+ */
+TreeNode* rdParse (void);
+
+/* Function crossCheck parses the token array again
+ * with rdParse and compares the tree to tree, the one
+ * bison built, printing the result to out.
+ * It returns TRUE if the trees differ.
+ */
+int crossCheck (TreeNode* tree, FILE* out);
+
+#endif
@@ -0,0 +1,350 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "globals.h"
+#include "server.h"
+
+int ServerJobs = 0;
+
+#define READ_BUFSIZE (1 << 16)
+/* words of a request line */
+#define MAX_WORDS 64
+
+/* Buffered reader of a request stream. */
+typedef struct {
+	int fd;
+	char buf[READ_BUFSIZE];
+	int pos;
+	int len;
+} Reader;
+
+/* A request being compiled. */
+typedef struct {
+	pid_t pid;
+	/* the listing written by the compiling process */
+	FILE* out;
+} Job;
+
+static int fill (Reader* r) {
+
+	ssize_t n;
+
+	do
+		n = read(r->fd, r->buf, READ_BUFSIZE);
+	while (n < 0 && errno == EINTR);
+	r->pos = 0;
+	r->len = n > 0 ? n : 0;
+	return r->len > 0;
+}
+
+/* Function waiting returns TRUE if more of the stream can
+ * be read without blocking. */
+static int waiting (Reader* r) {
+
+	struct pollfd p;
+
+	if (r->pos < r->len)
+		return TRUE;
+	p.fd = r->fd;
+	p.events = POLLIN;
+	return poll(&p, 1, 0) > 0;
+}
+
+/* Function readLine returns the next line without its
+ * newline, or NULL at the end of the stream. */
+static char* readLine (Reader* r) {
+
+	char* line = NULL;
+	size_t n = 0, cap = 0;
+
+	for (;;) {
+		char c;
+		if (r->pos == r->len && !fill(r)) {
+			if (line == NULL)
+				return NULL;
+			break;
+		}
+		c = r->buf[r->pos++];
+		if (n + 1 >= cap) {
+			cap = cap ? cap * 2 : 128;
+			line = (char*) realloc(line, cap);
+			if (line == NULL) {
+				fprintf(stderr, "Out of memory for the server\n");
+				exit(1);
+			}
+		}
+		if (c == '\n')
+			break;
+		line[n++] = c;
+	}
+	line[n] = '\0';
+	return line;
+}
+
+/* Function readBytes reads n bytes of the stream into text,
+ * returns FALSE if the stream ends first. */
+static int readBytes (Reader* r, char* text, size_t n) {
+
+	size_t got = 0;
+
+	while (got < n) {
+		size_t k;
+		if (r->pos == r->len && !fill(r))
+			return FALSE;
+		k = r->len - r->pos;
+		if (k > n - got)
+			k = n - got;
+		memcpy(text + got, r->buf + r->pos, k);
+		r->pos += k;
+		got += k;
+	}
+	return TRUE;
+}
+
+/* Function split breaks line into words at blanks,
+ * returns the number of words or -1 if too many. */
+static int split (char* line, char* words[]) {
+
+	int n = 0;
+	char* w;
+
+	for (w = strtok(line, " \t\r"); w != NULL; w = strtok(NULL, " \t\r")) {
+		if (n == MAX_WORDS - 1)
+			return -1;
+		words[n++] = w;
+	}
+	words[n] = NULL;
+	return n;
+}
+
+static void respond (FILE* out, int status, char* text, long len) {
+
+	fprintf(out, "result %d %ld\n", status, len);
+	fwrite(text, 1, len, out);
+	fflush(out);
+}
+
+/* Procedure finish waits for a job and sends its listing. */
+static void finish (Job* job, FILE* out) {
+
+	char buf[READ_BUFSIZE];
+	int st, status;
+	long len;
+	size_t n;
+
+	while (waitpid(job->pid, &st, 0) < 0 && errno == EINTR)
+		;
+	status = WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+	fseek(job->out, 0, SEEK_END);
+	len = ftell(job->out);
+	rewind(job->out);
+	fprintf(out, "result %d %ld\n", status, len);
+	while ((n = fread(buf, 1, sizeof(buf), job->out)) > 0)
+		fwrite(buf, 1, n, out);
+	fflush(out);
+	fclose(job->out);
+}
+
+/* Function start forks a process that compiles a request
+ * with its output in a temporary file. Its stdin is
+ * /dev/null, so IN of a --run request finds no input
+ * instead of reading the request stream, and the run
+ * ends at the step limit of the simulator. */
+static int start (Job* job, CompileProc compile, int argc, char* argv[],
+		char* text, size_t len) {
+
+	job->out = tmpfile();
+	if (job->out == NULL)
+		return FALSE;
+	fflush(stdout);
+	fflush(stderr);
+	job->pid = fork();
+	if (job->pid < 0) {
+		fclose(job->out);
+		return FALSE;
+	}
+	if (job->pid == 0) {
+		int status;
+		int null = open("/dev/null", O_RDONLY);
+		if (null < 0 || dup2(null, STDIN_FILENO) < 0)
+			_exit(1);
+		close(null);
+		dup2(fileno(job->out), STDOUT_FILENO);
+		dup2(fileno(job->out), STDERR_FILENO);
+		status = compile(argc, argv, text, len);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(status);
+	}
+	return TRUE;
+}
+
+/* Procedure serveStream answers the requests of one stream
+ * in order, compiling up to ServerJobs of them at a time.
+ * Replies are sent whenever the client has nothing more to
+ * send, so a client may wait for each reply or pipeline.
+ */
+static void serveStream (int in, int outFd, char* prog, CompileProc compile) {
+
+	Reader* r = (Reader*) malloc(sizeof(Reader));
+	FILE* out = fdopen(outFd, "w");
+	Job* jobs = (Job*) malloc(ServerJobs * sizeof(Job));
+	int first = 0, cnt = 0;
+	char* line;
+
+	if (r == NULL || out == NULL || jobs == NULL) {
+		fprintf(stderr, "Out of memory for the server\n");
+		exit(1);
+	}
+	r->fd = in;
+	r->pos = r->len = 0;
+	for (;;) {
+		char* words[MAX_WORDS + 1];
+		char* text = NULL;
+		size_t len = 0;
+		int n, argc = 0;
+
+		while (cnt > 0 && !waiting(r)) {
+			finish(&jobs[first], out);
+			first = (first + 1) % ServerJobs;
+			cnt--;
+		}
+		if ((line = readLine(r)) == NULL)
+			break;
+		n = split(line, words + 1);
+		if (n == 0) {
+			free(line);
+			continue;
+		}
+		if (n > 0 && strcmp(words[1], "quit") == 0) {
+			free(line);
+			break;
+		}
+		/* replies go in the order of the requests */
+		if (cnt == ServerJobs || n < 0
+				|| (strcmp(words[1], "compile") != 0 && strcmp(words[1], "source") != 0)) {
+			while (cnt > 0) {
+				finish(&jobs[first], out);
+				first = (first + 1) % ServerJobs;
+				cnt--;
+			}
+		}
+		if (n < 0)
+			respond(out, 1, "too many words in request\n", 26);
+		else if (strcmp(words[1], "compile") == 0 && n >= 2) {
+			words[1] = prog;
+			argc = n;
+		}
+		else if (strcmp(words[1], "source") == 0 && n >= 3) {
+			char* end;
+			long l = strtol(words[n], &end, 10);
+			if (*end != '\0' || l < 0) {
+				respond(out, 1, "bad source length\n", 18);
+				free(line);
+				continue;
+			}
+			len = l;
+			text = (char*) malloc(len + 1);
+			if (text == NULL || !readBytes(r, text, len)) {
+				free(text);
+				free(line);
+				respond(out, 1, "source ends early\n", 18);
+				break;
+			}
+			text[len] = '\0';
+			words[1] = prog;
+			words[n] = NULL;
+			argc = n - 1;
+		}
+		else
+			respond(out, 1, "unknown request\n", 16);
+		if (argc > 0) {
+			Job* job = &jobs[(first + cnt) % ServerJobs];
+			if (start(job, compile, argc, words + 1, text, len))
+				cnt++;
+			else
+				respond(out, 1, "cannot start the compilation\n", 29);
+		}
+		free(text);
+		free(line);
+	}
+	while (cnt > 0) {
+		finish(&jobs[first], out);
+		first = (first + 1) % ServerJobs;
+		cnt--;
+	}
+	fclose(out);
+	free(jobs);
+	free(r);
+}
+
+int serve (char* path, char* prog, CompileProc compile) {
+
+	struct sockaddr_un addr;
+	struct stat st;
+	int s;
+
+	if (ServerJobs < 1)
+		ServerJobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ServerJobs < 1)
+		ServerJobs = 1;
+	/* a client that goes away only ends its stream */
+	signal(SIGPIPE, SIG_IGN);
+	if (path == NULL) {
+		serveStream(STDIN_FILENO, STDOUT_FILENO, prog, compile);
+		return 0;
+	}
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path %s is too long\n", path);
+		return 1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	/* only the socket of an earlier server is replaced */
+	if (lstat(path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "%s exists and is not a socket\n", path);
+			return 1;
+		}
+		unlink(path);
+	}
+	s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s < 0 || bind(s, (struct sockaddr*) &addr, sizeof(addr)) < 0
+			|| listen(s, 16) < 0) {
+		fprintf(stderr, "Unable to listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	fprintf(stderr, "Listening on %s\n", path);
+	/* every connection is served by its own process */
+	for (;;) {
+		int c = accept(s, NULL, NULL);
+		pid_t pid;
+		while (waitpid(-1, NULL, WNOHANG) > 0)
+			;
+		if (c < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "accept: %s\n", strerror(errno));
+			break;
+		}
+		fflush(stderr);
+		pid = fork();
+		if (pid == 0) {
+			close(s);
+			serveStream(c, dup(c), prog, compile);
+			close(c);
+			_exit(0);
+		}
+		close(c);
+	}
+	close(s);
+	unlink(path);
+	return 1;
+}
@@ -0,0 +1,37 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+/* Requests are lines of words separated by blanks:
+ *	compile [options] <path>
+ *	source [options] <name> <length>
+ *	quit
+ * A source request is followed by length bytes of
+ * program text, compiled under the given name without
+ * writing code. Every request is answered by
+ *	result <status> <length>
+ * and length bytes of the listing, with the
+ * diagnostics, symbol table and reports.
+ */
+
+/* Requests compiled at the same time on one stream,
+ * by default one per processor. */
+extern int ServerJobs;
+
+/* Type of the function that compiles a request, with the
+ * options and file name of the request in argv, and the
+ * program text in text unless it is NULL. Returns the exit
+ * status of the compilation.
+ */
+typedef int (* CompileProc) (int argc, char* argv[], char* text, size_t len);
+
+/* Function serve answers requests read from stdin, or from
+ * the connections to a Unix socket bound at path unless it
+ * is NULL. A socket left at path is replaced, any other file
+ * fails the server. Each request is compiled by compile in a
+ * process forked from the server, so requests share no compiler
+ * state but what the server set up before, reads no stdin, and
+ * run ServerJobs at a time. Returns the exit status of the server.
+ */
+int serve (char* path, char* prog, CompileProc compile);
+
+#endif
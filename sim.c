@@ -0,0 +1,410 @@
+/*
+	File: sim.c
+	The TM machine simulator, runs the code
+	written by the code generator and counts
+	what it executes
+*/
+
+#include <unistd.h>
+#include "globals.h"
+#include "code.h"
+#include "sim.h"
+
+int RunCode = FALSE;
+int RunProfile = FALSE;
+long RunSteps = DEFAULT_RUN_STEPS;
+
+/* words of data memory */
+#define DADDR_SIZE (1 << 20)
+
+/* TM arithmetic wraps around like the machine it models,
+ * in unsigned arithmetic since int overflow is undefined. */
+#define WRAP(x) ((int) (unsigned int) (x))
+#define ADDR(i) WRAP((unsigned int) (i)->t + (unsigned int) reg[(i)->s])
+
+#define NO_REGS 8
+#define LINESIZE 512
+
+typedef enum {
+	opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV,
+	opRRLim,
+	opLD, opST,
+	opRMLim,
+	opLDA, opLDC, opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE,
+	opRALim,
+	/* a location the code file does not fill */
+	opNone
+} OpCode;
+
+static const char* opName[] = {
+	"HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "????",
+	"LD", "ST", "????",
+	"LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "????"
+};
+
+/* Cycles of each instruction, a taken jump
+ * costs TAKEN_COST more to refill the fetch. */
+static const int cost[] = {
+	1, 1, 1, 1, 1, 3, 10, 0,
+	2, 2, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 0, 0
+};
+#define TAKEN_COST 1
+
+typedef struct {
+	OpCode op;
+	int r;
+	int s;
+	int t;
+	/* source line from the last "* line N" comment */
+	int lineno;
+} Instr;
+
+static Instr* iMem = NULL;
+static int iSize = 0;
+static int* dMem = NULL;
+
+/* times each location was executed, and jumped from */
+static long* execCnt = NULL;
+static long* takenCnt = NULL;
+
+/* totals of the last run */
+static long steps, cycles, reads, writes, taken;
+static char* stopReason = NULL;
+static int stopLoc = -1;
+
+/* IN and OUT go through these buffers, not a stdio call
+ * per instruction. */
+#define IO_BUFSIZE (1 << 16)
+
+static char inBuf[IO_BUFSIZE];
+static int inPos = 0, inLen = 0;
+static char outBuf[IO_BUFSIZE];
+static int outLen = 0;
+
+static void flushOutput (void) {
+
+	fwrite(outBuf, 1, outLen, stdout);
+	fflush(stdout);
+	outLen = 0;
+}
+
+/* Function nextChar returns the next character of stdin,
+ * the output so far is written before waiting for more. */
+static int nextChar (void) {
+
+	if (inPos == inLen) {
+		ssize_t n;
+		flushOutput();
+		n = read(STDIN_FILENO, inBuf, IO_BUFSIZE);
+		inPos = 0;
+		inLen = n > 0 ? n : 0;
+		if (inLen == 0)
+			return EOF;
+	}
+	return (unsigned char) inBuf[inPos++];
+}
+
+/* Function readInt reads a decimal integer into v,
+ * returns FALSE at the end of input or on another token. */
+static int readInt (int* v) {
+
+	int c, neg = FALSE, digits = 0;
+	unsigned int n = 0;
+
+	while ((c = nextChar()) == ' ' || c == '\t' || c == '\n' || c == '\r')
+		;
+	if (c == '-' || c == '+') {
+		neg = c == '-';
+		c = nextChar();
+	}
+	for (; c >= '0' && c <= '9'; c = nextChar(), digits++)
+		n = n * 10 + (c - '0');
+	/* give back the character after the number */
+	if (c != EOF)
+		inPos--;
+	*v = WRAP(neg ? 0u - n : n);
+	return digits > 0;
+}
+
+static void writeInt (int v) {
+
+	char digits[12];
+	unsigned int n = v < 0 ? -(unsigned int) v : (unsigned int) v;
+	int k = 0;
+
+	if (outLen > IO_BUFSIZE - 16)
+		flushOutput();
+	do {
+		digits[k++] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0);
+	if (v < 0)
+		outBuf[outLen++] = '-';
+	while (k > 0)
+		outBuf[outLen++] = digits[--k];
+	outBuf[outLen++] = '\n';
+}
+
+static void* allocate (size_t n) {
+
+	void* p = calloc(1, n ? n : 1);
+
+	if (p == NULL) {
+		fprintf(stderr, "Out of memory for the simulator\n");
+		exit(1);
+	}
+	return p;
+}
+
+/* Procedure release frees the code and counters of the last run. */
+static void release (void) {
+
+	free(iMem);
+	free(dMem);
+	free(execCnt);
+	free(takenCnt);
+	iMem = NULL;
+	dMem = NULL;
+	execCnt = takenCnt = NULL;
+	iSize = 0;
+}
+
+/* Function loadCode reads the instructions of the code file,
+ * returns FALSE on an unreadable line. */
+static int loadCode (FILE* in, char* codefile) {
+
+	char line[LINESIZE], op[8];
+	int cap = 0, srcLine = 0, lineCnt = 0;
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		int loc, r, a, b, n;
+		char sep;
+		OpCode o;
+
+		lineCnt++;
+		/* the rest of an overlong comment */
+		if (strchr(line, '\n') == NULL && !feof(in)) {
+			int c;
+			while ((c = fgetc(in)) != EOF && c != '\n')
+				;
+		}
+		if (line[0] == '*') {
+			sscanf(line, "* line %d", &srcLine);
+			continue;
+		}
+		n = sscanf(line, "%d: %7s %d,%d%c%d", &loc, op, &r, &a, &sep, &b);
+		if (n <= 0)
+			continue;
+		for (o = opHALT; o < opRALim; o++)
+			if (strcmp(opName[o], op) == 0)
+				break;
+		if (n != 6 || loc < 0 || o == opRALim || o == opRRLim || o == opRMLim
+				|| (o < opRRLim ? sep != ',' : sep != '(')) {
+			fprintf(stderr, "%s:%d: bad TM instruction\n", codefile, lineCnt);
+			return FALSE;
+		}
+		if (loc >= cap) {
+			int old = cap, i;
+			cap = cap ? cap * 2 : 1024;
+			while (loc >= cap)
+				cap *= 2;
+			iMem = (Instr*) realloc(iMem, cap * sizeof(Instr));
+			if (iMem == NULL) {
+				fprintf(stderr, "Out of memory for the simulator\n");
+				exit(1);
+			}
+			for (i = old; i < cap; i++)
+				iMem[i].op = opNone;
+		}
+		iMem[loc].op = o;
+		iMem[loc].r = r;
+		iMem[loc].s = o < opRRLim ? a : b;
+		iMem[loc].t = o < opRRLim ? b : a;
+		iMem[loc].lineno = srcLine;
+		if (loc >= iSize)
+			iSize = loc + 1;
+	}
+	return TRUE;
+}
+
+/* stop ends the run at loc for reason. */
+#define stop(reason) { stopReason = reason; stopLoc = loc; return; }
+
+/* Procedure execute runs the loaded code from location 0
+ * for at most RunSteps instructions.
+ * RO instructions keep their operands in r, s and t,
+ * RM instructions their offset in t and base in s. */
+static void execute (void) {
+
+	int reg[NO_REGS] = {0};
+	int loc, a;
+	long left = RunSteps;
+
+	dMem[0] = DADDR_SIZE - 1;
+	for (;;) {
+		Instr* i;
+		loc = reg[pc];
+		if (loc < 0 || loc >= iSize || iMem[loc].op == opNone)
+			stop("Instruction memory fault");
+		if (left-- == 0)
+			stop("Step limit reached");
+		i = &iMem[loc];
+		execCnt[loc]++;
+		reg[pc] = loc + 1;
+		switch (i->op) {
+			case opHALT:
+				stop("HALT");
+			case opIN:
+				if (!readInt(&reg[i->r]))
+					stop("No input for IN");
+				break;
+			case opOUT:
+				writeInt(reg[i->r]);
+				break;
+			case opADD:
+				reg[i->r] = WRAP((unsigned int) reg[i->s] + (unsigned int) reg[i->t]);
+				break;
+			case opSUB:
+				reg[i->r] = WRAP((unsigned int) reg[i->s] - (unsigned int) reg[i->t]);
+				break;
+			case opMUL:
+				reg[i->r] = WRAP((unsigned int) reg[i->s] * (unsigned int) reg[i->t]);
+				break;
+			case opDIV:
+				if (reg[i->t] == 0)
+					stop("Division by zero");
+				/* INT_MIN / -1 wraps to INT_MIN */
+				if (reg[i->t] == -1)
+					reg[i->r] = WRAP(0u - (unsigned int) reg[i->s]);
+				else
+					reg[i->r] = reg[i->s] / reg[i->t];
+				break;
+			case opLD:
+				a = ADDR(i);
+				if (a < 0 || a >= DADDR_SIZE)
+					stop("Data memory fault");
+				reg[i->r] = dMem[a];
+				break;
+			case opST:
+				a = ADDR(i);
+				if (a < 0 || a >= DADDR_SIZE)
+					stop("Data memory fault");
+				dMem[a] = reg[i->r];
+				break;
+			case opLDA:
+				reg[i->r] = ADDR(i);
+				break;
+			case opLDC:
+				reg[i->r] = i->t;
+				break;
+			case opJLT:
+				if (reg[i->r] < 0) reg[pc] = ADDR(i);
+				break;
+			case opJLE:
+				if (reg[i->r] <= 0) reg[pc] = ADDR(i);
+				break;
+			case opJGT:
+				if (reg[i->r] > 0) reg[pc] = ADDR(i);
+				break;
+			case opJGE:
+				if (reg[i->r] >= 0) reg[pc] = ADDR(i);
+				break;
+			case opJEQ:
+				if (reg[i->r] == 0) reg[pc] = ADDR(i);
+				break;
+			case opJNE:
+				if (reg[i->r] != 0) reg[pc] = ADDR(i);
+				break;
+			default:
+				break;
+		}
+		if (reg[pc] != loc + 1)
+			takenCnt[loc]++;
+	}
+}
+
+int runCode (char* codefile) {
+
+	FILE* in = fopen(codefile, "r");
+	int i, ok;
+
+	release();
+	steps = cycles = reads = writes = taken = 0;
+	stopReason = NULL;
+	stopLoc = -1;
+	if (in == NULL) {
+		fprintf(stderr, "Unable to open %s\n", codefile);
+		return FALSE;
+	}
+	ok = loadCode(in, codefile);
+	fclose(in);
+	if (!ok)
+		return FALSE;
+	dMem = (int*) allocate(DADDR_SIZE * sizeof(int));
+	execCnt = (long*) allocate((iSize + 1) * sizeof(long));
+	takenCnt = (long*) allocate((iSize + 1) * sizeof(long));
+	execute();
+	flushOutput();
+
+	for (i = 0; i < iSize; i++) {
+		steps += execCnt[i];
+		taken += takenCnt[i];
+		cycles += execCnt[i] * cost[iMem[i].op] + takenCnt[i] * TAKEN_COST;
+		if (iMem[i].op == opLD)
+			reads += execCnt[i];
+		else if (iMem[i].op == opST)
+			writes += execCnt[i];
+	}
+	return strcmp(stopReason, "HALT") == 0;
+}
+
+/* Procedure printProfile prints the instructions, cycles
+ * and memory accesses of every source line executed. */
+static void printProfile (FILE* out) {
+
+	int maxLine = 0, i;
+	long* cnt;
+
+	for (i = 0; i < iSize; i++)
+		if (iMem[i].op != opNone && iMem[i].lineno > maxLine)
+			maxLine = iMem[i].lineno;
+	/* instructions, cycles, reads and writes by line */
+	cnt = (long*) allocate((maxLine + 1) * 4 * sizeof(long));
+	for (i = 0; i < iSize; i++) {
+		long* c = &cnt[iMem[i].lineno * 4];
+		if (iMem[i].op == opNone)
+			continue;
+		c[0] += execCnt[i];
+		c[1] += execCnt[i] * cost[iMem[i].op] + takenCnt[i] * TAKEN_COST;
+		if (iMem[i].op == opLD)
+			c[2] += execCnt[i];
+		else if (iMem[i].op == opST)
+			c[3] += execCnt[i];
+	}
+	fprintf(out, "  %6s%14s%8s%14s%12s%12s\n", "line", "instructions", "%",
+			"cycles", "reads", "writes");
+	for (i = 0; i <= maxLine; i++) {
+		long* c = &cnt[i * 4];
+		if (c[0] == 0)
+			continue;
+		/* line 0 is the prelude */
+		fprintf(out, "  %6d%14ld%8.1f%14ld%12ld%12ld\n", i, c[0],
+				100.0 * c[0] / steps, c[1], c[2], c[3]);
+	}
+	free(cnt);
+}
+
+void printRunReport (FILE* out) {
+
+	if (stopReason == NULL)
+		return;
+	fprintf(out, "\nRun report:\n");
+	if (strcmp(stopReason, "HALT") != 0)
+		fprintf(out, "  stopped at %d (line %d): %s\n", stopLoc,
+				stopLoc >= 0 && stopLoc < iSize ? iMem[stopLoc].lineno : 0, stopReason);
+	fprintf(out, "  %ld instructions, %ld cycles, %ld jumps taken\n", steps, cycles, taken);
+	fprintf(out, "  %ld memory reads, %ld memory writes\n", reads, writes);
+	if (RunProfile)
+		printProfile(out);
+}
@@ -0,0 +1,32 @@
+/*
+	File: sim.h
+	The TM machine simulator for the C-Minus compiler
+*/
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+/* Run the generated code after writing it. */
+extern int RunCode;
+/* Print the instructions executed by each source line. */
+extern int RunProfile;
+/* Instructions a run may execute before it is stopped. */
+extern long RunSteps;
+
+#define DEFAULT_RUN_STEPS 1000000000L
+
+/* Function runCode loads the TM code file codefile and
+ * executes it until HALT, an error or RunSteps
+ * instructions, reading IN from stdin and writing OUT
+ * to stdout. Returns FALSE if the file could not be
+ * loaded or the run did not end at HALT.
+ */
+int runCode (char* codefile);
+
+/* Procedure printRunReport prints the instructions,
+ * cycles and memory accesses of the last run, and the
+ * profile by source line if RunProfile is TRUE.
+ */
+void printRunReport (FILE* out);
+
+#endif
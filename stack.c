@@ -0,0 +1,136 @@
+#include "globals.h"
+#include "symtab.h"
+#include "callgraph.h"
+#include "stack.h"
+
+int StackReport = FALSE;
+
+/* Bytes of a frame besides parameters and locals:
+ * the saved frame pointer at 0 and the return address at -4. */
+#define FRAME_LINK 8
+
+/* Stack bounds that are not a number of bytes. */
+#define UNBOUNDED (-1)
+#define UNKNOWN (-2)
+
+/* worst case stack of each function and the callee 
+ * on its critical path, -1 at the end of the path. */
+static long* depth;
+static int* next;
+
+/* Function ownFrame returns the bytes of one
+ * activation of n, or UNKNOWN without its body.
+ */
+static long ownFrame (CallNodeRec* n) {
+
+	return n->frame < 0 ? UNKNOWN : n->params + FRAME_LINK + n->frame;
+}
+
+/* Procedure computeStack visits the functions callees 
+ * first, in the order of their strongly connected 
+ * components, so every callee is bounded before its callers.
+ */
+static void computeStack (void) {
+
+	int* order = (int*) malloc(callGraphSize * sizeof(int));
+	int* start = (int*) calloc(sccCount + 1, sizeof(int));
+	int i, j;
+
+	for (i = 0; i < callGraphSize; i++)
+		start[callGraph[i].scc + 1]++;
+	for (i = 0; i < sccCount; i++)
+		start[i + 1] += start[i];
+	for (i = 0; i < callGraphSize; i++)
+		order[start[callGraph[i].scc]++] = i;
+
+	for (i = 0; i < callGraphSize; i++) {
+		int v = order[i];
+		CallNodeRec* n = &callGraph[v];
+		long best = 0, own = ownFrame(n);
+		long state = 0;
+		next[v] = -1;
+		if (n->recursive || own == UNKNOWN) {
+			depth[v] = n->recursive ? UNBOUNDED : UNKNOWN;
+			continue;
+		}
+		/* an unbounded callee decides, then an unknown one. */
+		for (j = 0; j < n->ncallees; j++) {
+			int c = n->callees[j];
+			long d = depth[c];
+			if (d == UNBOUNDED) {
+				state = UNBOUNDED;
+				next[v] = c;
+				break;
+			}
+			if (d == UNKNOWN) {
+				if (state == 0) {
+					state = UNKNOWN;
+					next[v] = c;
+				}
+			}
+			else if (state == 0 && (next[v] < 0 || d > best)) {
+				best = d;
+				next[v] = c;
+			}
+		}
+		depth[v] = state ? state : own + best;
+	}
+	free(order);
+	free(start);
+}
+
+/* Procedure printPath prints the critical path from v. */
+static void printPath (FILE* out, int v) {
+
+	fprintf(out, "%s", callGraph[v].fn->name);
+	while (depth[v] != UNBOUNDED || !callGraph[v].recursive) {
+		if (next[v] < 0) {
+			if (depth[v] == UNKNOWN)
+				fprintf(out, " (unknown)");
+			return;
+		}
+		v = next[v];
+		fprintf(out, " -> %s", callGraph[v].fn->name);
+	}
+	fprintf(out, " (recursive)");
+}
+
+void printStackReport (FILE* out) {
+
+	int i, mainFn = -1;
+
+	depth = (long*) malloc((callGraphSize + 1) * sizeof(long));
+	next = (int*) malloc((callGraphSize + 1) * sizeof(int));
+	computeStack();
+
+	fprintf(out, "\nStack usage:\n");
+	fprintf(out, "  %-16s%8s%10s  %s\n", "function", "frame", "stack", "critical path");
+	for (i = 0; i < callGraphSize; i++) {
+		CallNodeRec* n = &callGraph[i];
+		char frame[16], stack[16];
+		if (ownFrame(n) == UNKNOWN)
+			strcpy(frame, "-");
+		else
+			snprintf(frame, sizeof(frame), "%ld", ownFrame(n));
+		if (depth[i] == UNBOUNDED)
+			strcpy(stack, "unbounded");
+		else if (depth[i] == UNKNOWN)
+			strcpy(stack, "unknown");
+		else
+			snprintf(stack, sizeof(stack), "%ld", depth[i]);
+		fprintf(out, "  %-16s%8s%10s  ", n->fn->name, frame, stack);
+		printPath(out, i);
+		fprintf(out, "\n");
+		if (strcmp(n->fn->name, "main") == 0)
+			mainFn = i;
+	}
+	if (mainFn >= 0) {
+		if (depth[mainFn] >= 0)
+			fprintf(out, "  main needs at most %ld bytes of stack\n", depth[mainFn]);
+		else
+			fprintf(out, "  the stack of main is %s\n", 
+					depth[mainFn] == UNBOUNDED ? "unbounded" : "unknown");
+	}
+	free(depth);
+	free(next);
+}
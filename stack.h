@@ -0,0 +1,15 @@
+#ifndef _STACK_H_
+#define _STACK_H_
+
+/* Print the stack usage report to stderr. */
+extern int StackReport;
+
+/* Procedure printStackReport bounds the stack used by
+ * every function and the calls it makes, from the frame
+ * sizes and the call graph, and prints it with the call
+ * chain that needs the most. Functions that can recurse,
+ * or call one that can, are unbounded.
+ */
+void printStackReport (FILE* out);
+
+#endif
@@ -0,0 +1,139 @@
+#include <time.h>
+#include <sys/resource.h>
+#include "globals.h"
+#include "stats.h"
+
+StatsRec stats;
+__thread StatsRec* statsLocal = &stats;
+
+/* start times of running phases. */
+static double wallStart[PHASE_CNT];
+static double cpuStart[PHASE_CNT];
+
+static const char* phaseName[PHASE_CNT] = 
+	{"scan", "parse", "buildSymtab", "printSymTab", "typeCheck", "dataflow", "codeGen", "run"};
+static const char* nodeName[4] = {"stmt", "exp", "decl", "type"};
+static const char* memName[MEM_CNT] = {"scan", "ast", "symtab"};
+
+static double now (clockid_t id) {
+
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void statsMerge (StatsRec* s) {
+
+	int i;
+	stats.tokens += s->tokens;
+	for (i = 0; i < 4; i++)
+		stats.nodes[i] += s->nodes[i];
+	stats.scopes += s->scopes;
+	stats.inserts += s->inserts;
+	stats.lookups += s->lookups;
+	stats.probes += s->probes;
+	stats.compares += s->compares;
+	for (i = 0; i < MEM_CNT; i++)
+		stats.bytes[i] += s->bytes[i];
+}
+
+double wallClock (void) {
+
+	return now(CLOCK_MONOTONIC);
+}
+
+void phaseBegin (PhaseKind p) {
+
+	if (!TimeReport)
+		return;
+	wallStart[p] = now(CLOCK_MONOTONIC);
+	cpuStart[p] = now(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void phaseEnd (PhaseKind p) {
+
+	struct rusage ru;
+	if (!TimeReport)
+		return;
+	stats.wall[p] += now(CLOCK_MONOTONIC) - wallStart[p];
+	stats.cpu[p] += now(CLOCK_PROCESS_CPUTIME_ID) - cpuStart[p];
+	getrusage(RUSAGE_SELF, &ru);
+	stats.maxrss[p] = ru.ru_maxrss;
+}
+
+/* Function lineRate returns source lines per second. */
+static double lineRate (double t) {
+
+	return t > 0 ? stats.lines / t : 0.0;
+}
+
+/* Function selfTime returns the time of phase p
+ * excluding the phase nested in it.
+ */
+static double selfTime (double* t, PhaseKind p) {
+
+	switch (p) {
+		case ParseP: return t[ParseP] - t[ScanP];
+		case SymtabP: return t[SymtabP] - t[PrintP];
+		default: return t[p];
+	}
+}
+
+void printStats (FILE* out, int json) {
+
+	int i;
+	double wall = 0, cpu = 0;
+	for (i = 0; i < PHASE_CNT; i++) {
+		wall += selfTime(stats.wall, i);
+		cpu += selfTime(stats.cpu, i);
+	}
+
+	if (json) {
+		fprintf(out, "{\"phases\": {");
+		for (i = 0; i < PHASE_CNT; i++)
+			fprintf(out, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f, "
+				"\"lines_per_s\": %.0f, \"maxrss_kb\": %ld}", i ? ", " : "",
+				phaseName[i], selfTime(stats.wall, i), selfTime(stats.cpu, i),
+				lineRate(selfTime(stats.wall, i)), stats.maxrss[i]);
+		fprintf(out, "}, \"total\": {\"wall\": %.6f, \"cpu\": %.6f, "
+			"\"lines_per_s\": %.0f}", wall, cpu, lineRate(wall));
+		fprintf(out, ", \"counters\": {\"lines\": %ld, \"tokens\": %ld", 
+			stats.lines, stats.tokens);
+		for (i = 0; i < 4; i++)
+			fprintf(out, ", \"nodes.%s\": %ld", nodeName[i], stats.nodes[i]);
+		fprintf(out, ", \"scopes\": %ld, \"inserts\": %ld, \"lookups\": %ld"
+			", \"probes\": %ld, \"compares\": %ld}",
+			stats.scopes, stats.inserts, stats.lookups, stats.probes, stats.compares);
+		fprintf(out, ", \"heap\": {");
+		for (i = 0; i < MEM_CNT; i++)
+			fprintf(out, "%s\"%s\": %ld", i ? ", " : "", memName[i], stats.bytes[i]);
+		fprintf(out, "}}\n");
+		return;
+	}
+
+	fprintf(out, "\n%-16s%12s%12s%14s%12s\n", "Phase", "Wall(s)", "CPU(s)", 
+		"Lines/s", "PeakRSS(KB)");
+	fprintf(out, "------------------------------------------------------------------\n");
+	for (i = 0; i < PHASE_CNT; i++)
+		fprintf(out, "%-16s%12.6f%12.6f%14.0f%12ld\n", phaseName[i], 
+			selfTime(stats.wall, i), selfTime(stats.cpu, i),
+			lineRate(selfTime(stats.wall, i)), stats.maxrss[i]);
+	fprintf(out, "%-16s%12.6f%12.6f%14.0f\n", "total", wall, cpu, lineRate(wall));
+
+	fprintf(out, "\n%-16s%12s\n", "Counter", "Count");
+	fprintf(out, "----------------------------\n");
+	fprintf(out, "%-16s%12ld\n", "lines", stats.lines);
+	fprintf(out, "%-16s%12ld\n", "tokens", stats.tokens);
+	for (i = 0; i < 4; i++)
+		fprintf(out, "nodes.%-10s%12ld\n", nodeName[i], stats.nodes[i]);
+	fprintf(out, "%-16s%12ld\n", "scopes", stats.scopes);
+	fprintf(out, "%-16s%12ld\n", "inserts", stats.inserts);
+	fprintf(out, "%-16s%12ld\n", "lookups", stats.lookups);
+	fprintf(out, "%-16s%12ld\n", "probes", stats.probes);
+	fprintf(out, "%-16s%12ld\n", "compares", stats.compares);
+
+	fprintf(out, "\n%-16s%12s\n", "Heap", "Bytes");
+	fprintf(out, "----------------------------\n");
+	for (i = 0; i < MEM_CNT; i++)
+		fprintf(out, "%-16s%12ld\n", memName[i], stats.bytes[i]);
+}
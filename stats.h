@@ -0,0 +1,81 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* Phases measured by the time report. 
+ * ScanP is nested in ParseP, PrintP is nested in SymtabP.
+ * FlowP times the analyses run after type checking,
+ * CodeP the code generation including the peephole,
+ * RunP the run of the code on the simulator.
+ */
+typedef enum {ScanP, ParseP, SymtabP, PrintP, CheckP, FlowP, CodeP, RunP, PHASE_CNT} PhaseKind;
+
+/* Subsystems whose heap allocations are counted. */
+typedef enum {ScanM, AstM, SymtabM, MEM_CNT} MemKind;
+
+/* Counters and timings of one compilation. */
+typedef struct StatsRec {
+
+	/* accumulated wall clock and cpu time in seconds. */
+	double wall[PHASE_CNT];
+	double cpu[PHASE_CNT];
+	/* peak resident set size in KB at the end of a phase. */
+	long maxrss[PHASE_CNT];
+
+	/* source lines compiled. */
+	long lines;
+
+	long tokens;
+	/* AST nodes by NodeKind. */
+	long nodes[4];
+	long scopes;
+	long inserts;
+	long lookups;
+	/* hash table buckets probed, one per scope searched. */
+	long probes;
+	/* bucket list entries compared. */
+	long compares;
+	/* heap bytes by MemKind. */
+	long bytes[MEM_CNT];
+} StatsRec;
+
+extern StatsRec stats;
+/* Counters of the calling thread: &stats, or a record 
+ * of its own for a worker thread, merged by statsMerge.
+ */
+extern __thread StatsRec* statsLocal;
+
+/* Counting is a single predictable branch while TimeReport is off.
+ * Define NO_STATS to compile the instrumentation out entirely.
+ */
+#ifdef NO_STATS
+#define STAT_ADD(f, n) ((void) 0)
+#else
+#define STAT_ADD(f, n) do { if (TimeReport) statsLocal->f += (n); } while (0)
+#endif
+#define STAT_INC(f) STAT_ADD(f, 1)
+#define STAT_ALLOC(m, n) STAT_ADD(bytes[m], (n))
+
+/* Procedure phaseBegin starts the clocks of a phase. */
+void phaseBegin (PhaseKind);
+
+/* Procedure phaseEnd stops the clocks of a phase
+ * and accumulates the elapsed time.
+ */
+void phaseEnd (PhaseKind);
+
+/* Procedure statsMerge adds the counters of a
+ * worker thread to stats.
+ */
+void statsMerge (StatsRec* s);
+
+/* Function wallClock returns a monotonic time in seconds,
+ * whether or not the time report is enabled.
+ */
+double wallClock (void);
+
+/* Procedure printStats prints the time report
+ * as a table, or as JSON if json is TRUE.
+ */
+void printStats (FILE*, int json);
+
+#endif
@@ -0,0 +1,207 @@
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "analyze.h"
+#include "callgraph.h"
+#include "iface.h"
+#include "diag.h"
+#include "stats.h"
+#include "bounds.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "vector.h"
+#include "stream.h"
+
+int Streaming = FALSE;
+long streamed = 0;
+
+/* Diagnostics of the symbol table, reported
+ * after the syntax errors as in batch mode. */
+static DiagList symDiags;
+
+/* Warnings of the analyses run after type checking,
+ * reported only if the program has no errors. */
+static DiagList flowDiags;
+
+/* A declaration with type checking diagnostics,
+ * or one whose check is deferred. */
+typedef struct PendingRec {
+
+	/* declaration still to check, or NULL. */
+	TreeNode* decl;
+	DiagList diags;
+} Pending;
+
+static Pending* pending = NULL;
+static int pendingCnt = 0;
+static int pendingCap = 0;
+
+/* The last declaration and the first one named main,
+ * kept without their bodies for mainCheck. */
+static TreeNode* lastDecl = NULL;
+static int lastDeferred = FALSE;
+static TreeNode* firstMain = NULL;
+
+/* Listing of the local scopes, written as each
+ * declaration is entered and copied out after the 
+ * global scope by streamSymtab. */
+static FILE* spill = NULL;
+
+static void addPending (TreeNode* decl, DiagList* diags) {
+
+	if (pendingCnt == pendingCap) {
+		pendingCap = pendingCap ? pendingCap * 2 : 64;
+		pending = (Pending*) realloc(pending, pendingCap * sizeof(Pending));
+		if (pending == NULL) {
+			fprintf(stderr, "Out of memory for streamed declarations\n");
+			exit(1);
+		}
+	}
+	pending[pendingCnt].decl = decl;
+	pending[pendingCnt].diags = *diags;
+	pendingCnt++;
+}
+
+/* Procedure freeDeclaration frees what is left of a
+ * declaration, dropping the pointers to it.
+ */
+static void freeDeclaration (TreeNode* t) {
+
+	if (t->nodekind == DeclK && t->kind.decl == FunK && t->sym) {
+		t->sym->params = NULL;
+		if (t->sym->sig && t->sym->sig->fid >= 0)
+			callGraph[t->sym->sig->fid].decl = NULL;
+	}
+	freeTree(t);
+}
+
+void streamBegin (void) {
+
+	diagCapture(&symDiags);
+	scope_push(scope_new());
+	st_declareIntrinsics();
+	importInterfaces();
+	diagCapture(NULL);
+}
+
+void streamDeclaration (TreeNode* t) {
+
+	DiagList diags = {NULL, 0, 0};
+	int first = scope_index;
+	int deferred;
+
+	if (t == NULL)
+		return;
+	streamed++;
+	/* Analysis is timed apart from the parse it interrupts. */
+	phaseEnd(ParseP);
+	phaseBegin(SymtabP);
+	diagCapture(&symDiags);
+	deferred = insertDeclaration(t);
+	diagCapture(NULL);
+	/* The line lists of local scopes are complete now. */
+	if (TraceAnalyze && (spill != NULL || (spill = tmpfile()) != NULL)) {
+		phaseBegin(PrintP);
+		printScopes(spill, first, scope_index);
+		phaseEnd(PrintP);
+	}
+	phaseEnd(SymtabP);
+
+	/* Batch mode finds names declared after their
+	 * use while checking, so wait for the whole scope. */
+	if (!deferred) {
+		phaseBegin(CheckP);
+		diagCapture(&diags);
+		checkDeclaration(t);
+		diagCapture(NULL);
+		phaseEnd(CheckP);
+		if (BoundsCheck || Dataflow || Vectorize) {
+			phaseBegin(FlowP);
+			diagCapture(&flowDiags);
+			if (BoundsCheck)
+				boundsDeclaration(t);
+			if (Dataflow)
+				dataflowDeclaration(t);
+			if (Vectorize)
+				vectorDeclaration(t);
+			diagCapture(NULL);
+			phaseEnd(FlowP);
+		}
+		scope_release(first);
+		freeTree(t->child[2]);
+		t->child[2] = NULL;
+		t->scope = NULL;
+	}
+	if (deferred || diags.cnt > 0)
+		addPending(deferred ? t : NULL, &diags);
+
+	if (lastDecl != NULL && lastDecl != firstMain && !lastDeferred)
+		freeDeclaration(lastDecl);
+	lastDecl = t;
+	lastDeferred = deferred;
+	if (firstMain == NULL && strcmp(t->attr.name, "main") == 0)
+		firstMain = t;
+	phaseBegin(ParseP);
+}
+
+void streamSymtab (void) {
+
+	char buf[BUFSIZ];
+	size_t n;
+
+	diagReplay(&symDiags);
+	cg_finish();
+	diagFlush(listing);
+	if (TraceAnalyze) {
+
+		phaseBegin(PrintP);
+		fprintf(listing, "\nSymbol table:\n\n");
+		printScopes(listing, 0, 1);
+		if (spill != NULL) {
+			rewind(spill);
+			while ((n = fread(buf, 1, sizeof(buf), spill)) > 0)
+				fwrite(buf, 1, n, listing);
+			fclose(spill);
+			spill = NULL;
+		}
+		phaseEnd(PrintP);
+	}
+	scope_pop();
+}
+
+void streamCheck (void) {
+
+	TreeNode* list = lastDecl;
+	int i;
+
+	/* What mainCheck looks at of the whole list. */
+	if (firstMain != NULL && firstMain != lastDecl) {
+		firstMain->sibling = lastDecl;
+		list = firstMain;
+	}
+	mainCheck(list);
+	scope_push(scope[0]);
+	for (i = 0; i < pendingCnt; i++)
+		if (pending[i].decl != NULL)
+			checkDeclaration(pending[i].decl);
+		else
+			diagReplay(&pending[i].diags);
+	scope_pop();
+	diagFlush(listing);
+}
+
+void streamFlow (void) {
+
+	int i;
+
+	for (i = 0; i < pendingCnt; i++)
+		if (pending[i].decl != NULL) {
+			if (BoundsCheck)
+				boundsDeclaration(pending[i].decl);
+			if (Dataflow)
+				dataflowDeclaration(pending[i].decl);
+			if (Vectorize)
+				vectorDeclaration(pending[i].decl);
+		}
+	diagReplay(&flowDiags);
+}
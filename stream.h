@@ -0,0 +1,42 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+/* Analyze each top level declaration as soon as it
+ * is parsed and free it, instead of keeping the tree. */
+extern int Streaming;
+
+/* Top level declarations streamed so far. */
+extern long streamed;
+
+/* Procedure streamBegin pushes the global scope
+ * and imports the interfaces, before parsing.
+ */
+void streamBegin (void);
+
+/* Procedure streamDeclaration enters a parsed top level
+ * declaration into the symbol table, type checks it
+ * and frees it. A declaration using names that are not
+ * declared yet is kept and checked by streamCheck,
+ * when the whole global scope is known.
+ */
+void streamDeclaration (TreeNode* t);
+
+/* Procedure streamSymtab reports the symbol table
+ * diagnostics of the streamed declarations and
+ * completes the symbol table, as buildSymtab does.
+ * The listing of the local scopes was kept on disk.
+ */
+void streamSymtab (void);
+
+/* Procedure streamCheck reports the type checking
+ * diagnostics in source order, as typeCheck does.
+ */
+void streamCheck (void);
+
+/* Procedure streamFlow reports the warnings of the
+ * bounds and dataflow analyses, run on each declaration
+ * as it was checked, and analyzes the deferred ones.
+ */
+void streamFlow (void);
+
+#endif
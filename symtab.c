@@ -1,19 +1,60 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include "globals.h"
 #include "symtab.h"
+#include "stats.h"
+#include "util.h"
 
 /* index of scope list. */
 int scope_index = 0;
 
 /* List of scopes. */
-ScopeList scope[MAX_SCOPE];
+ScopeList* scope = NULL;
+static int scope_cap = 0;
 
-/* Top of stack. */
-static int top = 0;
+/* Top of stack. Every thread has its own scope stack,
+ * so function bodies can be checked in parallel. */
+static __thread int top = 0;
 /* Stack of scopes. */
-ScopeList scope_stack[MAX_SCOPE];
+static __thread ScopeList* scope_stack = NULL;
+static __thread int stack_cap = 0;
+
+/* Interned name: the hash is stored in front of the characters. */
+typedef struct NameRec {
+
+	unsigned hash;
+	/* length of str, compared before its characters. */
+	size_t len;
+	struct NameRec* next;
+	/* innermost active declaration, used by shadow stacks. */
+	BucketList active;
+	char str[];
+} NameRec;
+
+#define NAME_REC(s) ((NameRec*) ((s) - offsetof(NameRec, str)))
+
+/* Name table, a power of two sized chained hash table. */
+static NameRec** names = NULL;
+static unsigned nameCap = 0;
+static unsigned nameCnt = 0;
+
+/* Resolve names through per-name shadow stacks. */
+int ShadowStacks = FALSE;
+
+/* Function grow doubles the capacity of a scope array. */
+static ScopeList* grow (ScopeList* a, int* cap) {
+
+	*cap = *cap ? *cap * 2 : MAX_SCOPE;
+	a = (ScopeList*) realloc(a, *cap * sizeof(ScopeList));
+	if (a == NULL) {
+		fprintf(stderr, "Out of memory for scopes\n");
+		exit(1);
+	}
+	return a;
+}
 
 
 /* Function scope_top returns
@@ -34,60 +75,292 @@ void scope_push (struct ScopeListRec* sc) {
 	if (!sc)
 		return;
 	
-	if (top < MAX_SCOPE)
-		scope_stack[top++] = sc;	
+	if (top >= stack_cap)
+		scope_stack = grow(scope_stack, &stack_cap);
+	scope_stack[top++] = sc;	
+
+	if (ShadowStacks) {
+		/* Activate the declarations of the scope. */
+		BucketList l;
+		for (l = sc->first; l; l = l->nextInScope) {
+			NameRec* n = NAME_REC(l->name);
+			l->shadowed = n->active;
+			n->active = l;
+		}
+	}
 	return;
 }
 
 void scope_pop (void) {
 
-	if (top > 0)
-		top -=  1;
+	if (top <= 0)
+		return;
+	if (ShadowStacks) {
+		/* Deactivate the declarations of the scope. */
+		BucketList l;
+		for (l = scope_stack[top - 1]->first; l; l = l->nextInScope)
+			NAME_REC(l->name)->active = l->shadowed;
+	}
+	top -=  1;
 	return;
 }
 
 struct ScopeListRec* scope_new (void) {
 
-	/* If space allows, */
-	if (scope_index < MAX_SCOPE) {
-		struct ScopeListRec* t
-			= (struct ScopeListRec*) malloc (sizeof(struct ScopeListRec));
-
-		t->level = top;
-		t->parent = scope_top();
-		int i;
-		for (i = 0; i < SIZE; i++)
-			t->hashTable[i] = NULL;
-
-		if (t->level == 0) 
-			t->varLoc = 0;
-		else if (t->level == 1)
-			t->varLoc = -4;
-		else
-			t->varLoc = t->parent->varLoc;
-		t->funcLoc = 0;
-		t->paramLoc = 4;
+	struct ScopeListRec* t
+		= (struct ScopeListRec*) malloc (sizeof(struct ScopeListRec));
+	STAT_INC(scopes);
+	STAT_ALLOC(SymtabM, sizeof(struct ScopeListRec));
+
+	t->level = top;
+	t->parent = scope_top();
+	int i;
+	for (i = 0; i < SIZE; i++)
+		t->hashTable[i] = NULL;
+
+	if (t->level == 0) 
+		t->varLoc = 0;
+	else if (t->level == 1)
+		t->varLoc = -4;
+	else
+		t->varLoc = t->parent->varLoc;
+	t->funcLoc = 0;
+	t->paramLoc = 4;
+	t->first = t->last = NULL;
+	t->id = scope_index;
+
+	if (scope_index >= scope_cap)
+		scope = grow(scope, &scope_cap);
+	scope[scope_index] = t;
+	scope_index += 1;
+	return t;
+}
 
-		scope[scope_index] = t;
-		scope_index += 1;
-		return t;
+void scope_release (int first) {
+
+	while (scope_index > first) {
+		ScopeList sc = scope[--scope_index];
+		BucketList l = sc->first;
+		while (l != NULL) {
+			BucketList next = l->nextInScope;
+			LineList t = l->lines;
+			while (t != NULL) {
+				LineList n = t->next;
+				free(t);
+				t = n;
+			}
+			free(l->sig);
+			free(l);
+			l = next;
+		}
+		free(sc);
+		scope[scope_index] = NULL;
 	}
-	else
+}
+
+/* Function strHash hashes a string 
+ * a machine word at a time.
+ */
+static unsigned strHash (const char* key, size_t len) {
+
+	const uint64_t k = 0x9E3779B97F4A7C15ULL;
+	uint64_t h = len * k, w;
+	while (len >= 8) {
+		memcpy(&w, key, 8);
+		h = (h ^ w) * k;
+		h ^= h >> 32;
+		key += 8;
+		len -= 8;
+	}
+	if (len > 0) {
+		w = 0;
+		memcpy(&w, key, len);
+		h = (h ^ w) * k;
+	}
+	/* final avalanche. */
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return (unsigned) h;
+}
+
+static void growNames (void) {
+
+	unsigned cap = nameCap ? nameCap * 2 : 1024;
+	NameRec** t = (NameRec**) calloc(cap, sizeof(NameRec*));
+	unsigned i;
+	STAT_ALLOC(ScanM, cap * sizeof(NameRec*));
+	for (i = 0; i < nameCap; i++) {
+		NameRec* n = names[i];
+		while (n) {
+			NameRec* next = n->next;
+			n->next = t[n->hash & (cap - 1)];
+			t[n->hash & (cap - 1)] = n;
+			n = next;
+		}
+	}
+	free(names);
+	names = t;
+	nameCap = cap;
+}
+
+char* st_intern (char* name) {
+
+	if (!name)
 		return NULL;
+	return st_internN(name, strlen(name));
 }
 
-/* the hash function */
+char* st_internN (const char* name, size_t len) {
+
+	unsigned h;
+	NameRec* n;
+	h = strHash(name, len);
+	if (nameCnt >= nameCap / 4 * 3)
+		growNames();
+	for (n = names[h & (nameCap - 1)]; n; n = n->next)
+		if (n->hash == h && n->len == len && memcmp(n->str, name, len) == 0)
+			return n->str;
+
+	n = (NameRec*) malloc(sizeof(NameRec) + len + 1);
+	STAT_ALLOC(ScanM, sizeof(NameRec) + len + 1);
+	n->hash = h;
+	n->len = len;
+	n->active = NULL;
+	memcpy(n->str, name, len);
+	n->str[len] = '\0';
+	n->next = names[h & (nameCap - 1)];
+	names[h & (nameCap - 1)] = n;
+	nameCnt += 1;
+	return n->str;
+}
+
+/* the hash function, reads the hash stored by st_intern. */
 static int hash (char* key) {
 	if (!key)
 		return 0;
+	return NAME_REC(key)->hash % SIZE;
+}
+
+/* Function findLocal returns the record of name
+ * in the current scope, or NULL.
+ */
+static BucketList findLocal (char* name) {
 
-	int temp = 0;
-	int i = 0;
-	while(key[i] != '\0') {
-		temp = ((temp << SHIFT) + key[i]) % SIZE;
-		++i;
+	BucketList l;
+	STAT_INC(probes);
+	if (ShadowStacks) {
+		l = NAME_REC(name)->active;
+		return l && l->owner == scope_top() ? l : NULL;
 	}
-	return temp;
+	for (l = scope_top()->hashTable[hash(name)]; l; l = l->next) {
+		STAT_INC(compares);
+		if (name == l->name) break;
+	}
+	return l;
+}
+
+/* Procedure addLine appends a line number to a record. */
+static void addLine (BucketList l, int lineno) {
+
+	LineList t = (LineList) malloc (sizeof(struct LineListRec));
+	STAT_ALLOC(SymtabM, sizeof(struct LineListRec));
+	t->lineno = lineno;
+	t->next = NULL;
+	if (l->lastLine)
+		l->lastLine->next = t;
+	else
+		l->lines = t;
+	l->lastLine = t;
+}
+
+/* Function newRecord creates the record of name
+ * in the current scope.
+ */
+static BucketList newRecord (char* name, int lineno, int loc, 
+		char VPF, int type, int len, TreeNode* params) {
+
+	int h = hash(name);
+	BucketList l;
+	STAT_INC(inserts);
+	STAT_ALLOC(SymtabM, sizeof(struct BucketListRec));
+	l = (BucketList) malloc (sizeof(struct BucketListRec));
+	l->name = name;
+	l->lines = l->lastLine = NULL;
+	/* intrinsics and imports are declared at line 0,
+	 * outside the source. */
+	if (lineno > 0)
+		addLine(l, lineno);
+	l->memloc = loc;
+
+	/* Aux fields. */
+	l->VPF = VPF;
+	l->type = type;
+	l->len = len;
+	l->params = params;
+	l->sig = NULL;
+	l->live = FALSE;
+	l->imported = FALSE;
+	l->index = -1;
+	l->intrinsic = NO_INTRINSIC;
+
+	l->next = scope_top()->hashTable[h];
+	scope_top()->hashTable[h] = l;
+
+	l->nextInScope = NULL;
+	if (scope_top()->last)
+		scope_top()->last->nextInScope = l;
+	else
+		scope_top()->first = l;
+	scope_top()->last = l;
+
+	l->owner = scope_top();
+	if (ShadowStacks) {
+		l->shadowed = NAME_REC(name)->active;
+		NAME_REC(name)->active = l;
+	}
+	return l;
+}
+
+/* Procedure hideRecord takes record l of the current scope
+ * off its hash chain, its scope list and its shadow stack, so
+ * that its name can be declared again. Nodes already resolved
+ * to l keep it.
+ */
+static void hideRecord (BucketList l) {
+
+	ScopeList sc = l->owner;
+	BucketList* p;
+
+	for (p = &sc->hashTable[hash(l->name)]; *p != NULL; p = &(*p)->next)
+		if (*p == l) {
+			*p = l->next;
+			break;
+		}
+	if (sc->first == l) {
+		sc->first = l->nextInScope;
+		if (sc->last == l)
+			sc->last = NULL;
+	}
+	else {
+		BucketList q;
+		for (q = sc->first; q != NULL && q->nextInScope != l; q = q->nextInScope)
+			;
+		if (q != NULL) {
+			q->nextInScope = l->nextInScope;
+			if (sc->last == l)
+				sc->last = q;
+		}
+	}
+	if (ShadowStacks && NAME_REC(l->name)->active == l)
+		NAME_REC(l->name)->active = l->shadowed;
+}
+
+/* Function unused returns TRUE for an intrinsic function
+ * the program does not call, which is left out of listings. */
+static int unused (BucketList l) {
+
+	return l->intrinsic != NO_INTRINSIC && l->lines == NULL;
 }
 
 /* Procedure st_insert inserts line numbers and
@@ -97,44 +370,90 @@ static int hash (char* key) {
  */
 void st_insert (char* name, int lineno, int loc, char VPF, int type, int len, TreeNode* params) {
 
-	int h = hash(name);
 	BucketList l = NULL;
 	if(scope_top() == NULL)
 		return;
 	
-	l = scope_top()->hashTable[h];
+	l = findLocal(name);
+	if (l == NULL) /* variable not yet in table */
+		newRecord(name, lineno, loc, VPF, type, len, params);
+	else /* found in table, so just add line number */
+		addLine(l, lineno);
+}
 
-	while(1) {
-		if (l == NULL) break;
-		if (strcmp(name, l->name) == 0) break;
-		l = l->next;
-	}
-	if (l == NULL) { /* variable not yet in table */
-		l = (BucketList) malloc (sizeof(struct BucketListRec));
-		l->name = name;
-		l->lines = (LineList) malloc (sizeof(struct LineListRec));
-		l->lines->lineno = lineno;
-		l->lines->next = NULL;
-		l->memloc = loc;
-
-		/* Aux fields. */
-		l->VPF = VPF;
-		l->type = type;
-		l->len = len;
-		l->params = params;
-
-		l->next = scope_top()->hashTable[h];
-		scope_top()->hashTable[h] = l;
-	}
-	else { /* found in table, so just add line number */
-		LineList t = l->lines;
-		if (t != NULL) {
-			while(t->next) t = t->next;
-			t->next = (LineList) malloc (sizeof(struct LineListRec));
-			t->next->lineno = lineno;
-			t->next->next = NULL;
-		}
-	}
+/* Function st_declare inserts a declaration into the
+ * current scope with a single search, and returns its
+ * record, or NULL if the name is already declared there.
+ */
+BucketList st_declare (char* name, int lineno, int loc, char VPF, int type, int len, TreeNode* params) {
+
+	BucketList l;
+	if (scope_top() == NULL)
+		return NULL;
+	l = findLocal(name);
+	if (l != NULL && l->intrinsic == NO_INTRINSIC)
+		return NULL;
+	if (l != NULL)
+		hideRecord(l);
+	return newRecord(name, lineno, loc, VPF, type, len, params);
+}
+
+/* Procedure declareIntrinsic declares one runtime function. */
+static void declareIntrinsic (char* name, int type, int param, int intrinsic) {
+
+	BucketList l = newRecord(st_intern(name), 0, -1, 'F', type, 0, NULL);
+	l->sig = st_newSignature(param == Void ? 0 : 1);
+	if (param != Void)
+		l->sig->types[0] = param;
+	l->intrinsic = intrinsic;
+}
+
+void st_declareIntrinsics (void) {
+
+	if (scope_top() == NULL)
+		return;
+	declareIntrinsic("input", Integer, Void, INPUT_INTRINSIC);
+	declareIntrinsic("output", Void, Integer, OUTPUT_INTRINSIC);
+}
+
+/* Function st_newSignature allocates the signature
+ * of a function with arity parameters.
+ */
+Signature st_newSignature (int arity) {
+
+	Signature sig = (Signature) malloc(sizeof(struct SignatureRec) + arity);
+	STAT_ALLOC(SymtabM, sizeof(struct SignatureRec) + arity);
+	sig->arity = arity;
+	sig->fid = -1;
+	return sig;
+}
+
+/* Function st_signature builds the signature of
+ * a function from its parameter list.
+ */
+Signature st_signature (TreeNode* params) {
+
+	TreeNode* p;
+	int n = 0;
+	Signature sig;
+	for (p = params; p; p = p->sibling)
+		n++;
+	sig = st_newSignature(n);
+	for (p = params, n = 0; p; p = p->sibling, n++)
+		sig->types[n] = p->child[0] ? p->child[0]->type : ANY_TYPE;
+	return sig;
+}
+
+/* Function st_reference looks up a name through the
+ * enclosing scopes and appends the line number to its
+ * record. Returns the record or NULL if not declared.
+ */
+BucketList st_reference (char* name, int lineno) {
+
+	BucketList l = st_lookup(name);
+	if (l != NULL)
+		addLine(l, lineno);
+	return l;
 }
 
 /* Procedure st_insert_global inserts line number to 
@@ -142,19 +461,7 @@ void st_insert (char* name, int lineno, int loc, char VPF, int type, int len, Tr
  */
 void st_insert_global (char* name, int lineno) {
 
-	BucketList l = st_lookup(name);
-	if (l == NULL) {
-		/* Do nothing */;
-	}
-	else {
-		LineList t = l->lines;
-		if (t != NULL) {
-			while(t->next) t = t->next;
-			t->next = (LineList) malloc (sizeof(struct LineListRec));
-			t->next->lineno = lineno;
-			t->next->next = NULL;
-		}
-	}
+	st_reference(name, lineno);
 	return;
 }
 
@@ -163,14 +470,22 @@ void st_insert_global (char* name, int lineno) {
  */
 BucketList st_lookup (char* name) {
 
-	int h = hash(name);
+	int h;
 	struct ScopeListRec* sc = scope_top();
 	BucketList l = NULL;
+	STAT_INC(lookups);
+	if (ShadowStacks) {
+		STAT_INC(probes);
+		return name ? NAME_REC(name)->active : NULL;
+	}
+	h = hash(name);
 	while (sc) {
 		l = sc->hashTable[h];
+		STAT_INC(probes);
 		while(1) {
 			if (l == NULL) break;
-			if (strcmp(name, l->name) == 0) break;
+			STAT_INC(compares);
+			if (name == l->name) break;
 			l = l->next;
 		}
 
@@ -187,77 +502,189 @@ BucketList st_lookup (char* name) {
  */
 BucketList st_lookup_local (char* name) {
 
-	if (scope_top() == NULL)
+	if (scope_top() == NULL || name == NULL)
 		return NULL;
-
-	int h = hash(name);
-	BucketList l = scope_top()->hashTable[h];
-	while(1) {
-		if (l == NULL) break;
-		if (strcmp(name, l->name) == 0) break;
-		l = l->next;
-	}
-	return l;
+	STAT_INC(lookups);
+	return findLocal(name);
 }
 
 /* Procedure printSymTab prints a formatted listing
  * of the symbol table contents
  * to the listing file.
+ * Only the occupied entries of each scope are visited,
+ * in declaration order.
  */
 void printSymTab(FILE* listing) {
 
-	int i, j;
-	for (i = 0; i < scope_index ; i++) {
+	printScopes(listing, 0, scope_index);
+}
+
+void printScopes (FILE* listing, int first, int last) {
+
+	int i;
+	outOpen(listing);
+	for (i = first; i < last; i++) {
 
 		if (scope[i] == NULL) continue;
 
-		fprintf(listing, "%-8s%-8s%-8s%-8s%-8s%-8s%-8s%-16s\n", 
-			"Name", "Scope", "Loc", "V/P/F", "Array?", "ArrSize", "Type", "Line numbers");
-		fprintf(listing, "------------------------------------------------------------------------------------\n");
-
-		for (j=0; j < SIZE; j++) {
-
-			BucketList l = scope[i]->hashTable[j];
-			while(l != NULL) {
-				fprintf(listing, "%-8s", l->name);
-				fprintf(listing, "%-8d", scope[i]->level);
-				fprintf(listing, "%-8d", l->memloc);
-
-				switch(l->VPF) {
-					case 'V': fprintf(listing, "%-8s", "Var"); break;
-					case 'P': fprintf(listing, "%-8s", "Par"); break;
-					case 'F': fprintf(listing, "%-8s", "Func"); break;
-					default: ;
-				}
-
-				if (l->type == Array) {
-					fprintf(listing, "%-8s", "Array");
-					fprintf(listing, "%-8d", l->len);
-				}
-				else {
-					fprintf(listing, "%-8s", "No");
-					fprintf(listing, "%-8s", "-");
-				}
-
-				switch(l->type) {
-					case Void:
-						fprintf(listing, "%-8s", "void"); break;
-					case Integer:
-						fprintf(listing, "%-8s", "int"); break;
-					case Array:
-						fprintf(listing, "%-8s", "array"); break;
-					default: ;
-				}
-				
-				LineList t = l->lines;
-				while(t != NULL) {
-					fprintf(listing, "%-4d ", t->lineno);
-					t = t->next;
-				}
-				fprintf(listing, "\n");
-				l = l->next;
+		outStr("Name    Scope   Loc     V/P/F   Array?  ArrSize Type    Line numbers    \n");
+		outStr("------------------------------------------------------------------------------------\n");
+
+		BucketList l;
+		for (l = scope[i]->first; l != NULL; l = l->nextInScope) {
+			if (unused(l))
+				continue;
+			outPad(l->name, 8);
+			outInt(scope[i]->level, 8);
+			outInt(l->memloc, 8);
+
+			switch(l->VPF) {
+				case 'V': outPad("Var", 8); break;
+				case 'P': outPad("Par", 8); break;
+				case 'F': outPad("Func", 8); break;
+				default: ;
+			}
+
+			if (l->type == Array) {
+				outPad("Array", 8);
+				outInt(l->len, 8);
+			}
+			else 
+				outPad("No      -", 16);
+
+			switch(l->type) {
+				case Void: outPad("void", 8); break;
+				case Integer: outPad("int", 8); break;
+				case Array: outPad("array", 8); break;
+				default: ;
+			}
+			
+			LineList t;
+			for (t = l->lines; t != NULL; t = t->next) {
+				outInt(t->lineno, 4);
+				outChar(' ');
+			}
+			outChar('\n');
+		}
+		outChar('\n');
+	}
+	outFlush();
+}
+
+/* Procedure printSymTabJSON exports every scope 
+ * and symbol as a JSON document. Names consist of
+ * letters only and need no escaping.
+ */
+void printSymTabJSON (FILE* out) {
+
+	int i;
+	outOpen(out);
+	outStr("{\"scopes\": [");
+	for (i = 0; i < scope_index; i++) {
+		BucketList l;
+		int firstOut = TRUE;
+		if (i > 0) outChar(',');
+		outStr("\n {\"id\": ");
+		outInt(i, 0);
+		outStr(", \"level\": ");
+		outInt(scope[i]->level, 0);
+		outStr(", \"parent\": ");
+		outInt(scope[i]->parent ? scope[i]->parent->id : -1, 0);
+		outStr(", \"symbols\": [");
+		for (l = scope[i]->first; l != NULL; l = l->nextInScope) {
+			LineList t;
+			if (unused(l))
+				continue;
+			outStr(firstOut ? "\n  " : ",\n  ");
+			firstOut = FALSE;
+			outStr("{\"name\": \"");
+			outStr(l->name);
+			outStr("\", \"level\": ");
+			outInt(scope[i]->level, 0);
+			outStr(", \"memloc\": ");
+			outInt(l->memloc, 0);
+			outStr(", \"vpf\": \"");
+			outChar(l->VPF);
+			outStr("\", \"type\": ");
+			switch(l->type) {
+				case Void: outStr("\"void\""); break;
+				case Integer: outStr("\"int\""); break;
+				default: outStr("\"array\""); break;
+			}
+			outStr(", \"len\": ");
+			outInt(l->len, 0);
+			outStr(", \"lines\": [");
+			for (t = l->lines; t != NULL; t = t->next) {
+				outInt(t->lineno, 0);
+				if (t->next) outStr(", ");
 			}
+			outStr("]}");
+		}
+		outStr("]}");
+	}
+	outStr("\n]}\n");
+	outFlush();
+}
+
+/* Chain lengths from 0 to HIST_MAX - 1 are counted separately, 
+ * longer chains in the last slot.
+ */
+#define HIST_MAX 8
+
+static void printHistogram (FILE* out, long* hist) {
+
+	int i;
+	fprintf(out, "  chain length histogram:");
+	for (i = 0; i < HIST_MAX; i++)
+		fprintf(out, " %d%s:%ld", i, i == HIST_MAX - 1 ? "+" : "", hist[i]);
+	fprintf(out, "\n");
+}
+
+/* Procedure printHashStats prints bucket occupancy 
+ * and chain length histograms of every scope 
+ * and of the name table.
+ */
+void printHashStats (FILE* out) {
+
+	int i, j;
+	unsigned u;
+	for (i = 0; i < scope_index; i++) {
+		long hist[HIST_MAX] = {0};
+		int used = 0, entries = 0, longest = 0;
+		/* sum of chain positions of all entries,
+		 * i.e. compares of all successful lookups. */
+		long cost = 0;
+		if (scope[i] == NULL) continue;
+		for (j = 0; j < SIZE; j++) {
+			int len = 0;
+			BucketList l;
+			for (l = scope[i]->hashTable[j]; l; l = l->next)
+				cost += ++len;
+			hist[len < HIST_MAX ? len : HIST_MAX - 1]++;
+			if (len) used++;
+			if (len > longest) longest = len;
+			entries += len;
+		}
+		fprintf(out, "scope %d (level %d): %d entries, %d/%d buckets used, "
+			"longest chain %d, avg compares %.2f\n", i, scope[i]->level, 
+			entries, used, SIZE, longest, entries ? (double) cost / entries : 0.0);
+		printHistogram(out, hist);
+	}
+
+	if (nameCap > 0) {
+		long hist[HIST_MAX] = {0};
+		int used = 0, longest = 0;
+		for (u = 0; u < nameCap; u++) {
+			int len = 0;
+			NameRec* n;
+			for (n = names[u]; n; n = n->next)
+				len++;
+			hist[len < HIST_MAX ? len : HIST_MAX - 1]++;
+			if (len) used++;
+			if (len > longest) longest = len;
 		}
-		fprintf(listing, "\n");
+		fprintf(out, "names: %u entries, %d/%u buckets used, longest chain %d\n",
+			nameCnt, used, nameCap, longest);
+		printHistogram(out, hist);
 	}
 }
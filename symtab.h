@@ -4,10 +4,8 @@
 /* SIZE is the size of the hash table. */
 #define SIZE 211
 
-/* SHIFT is the power of two used as multiplier */
-#define SHIFT 4
-
-/* Maximum scope level. */
+/* Initial capacity of the scope list and scope stack,
+ * both grow on demand. */
 #define MAX_SCOPE 200
 
 /* the list of line numbers of the source code
@@ -19,6 +17,20 @@ typedef struct LineListRec {
 	struct LineListRec* next;
 }* LineList;
 
+/* Parameter type of an untyped parameter, matches any argument. */
+#define ANY_TYPE 0xFF
+
+/* Signature of a function, built once at declaration.
+ * types holds one ExpType per parameter.
+ */
+typedef struct SignatureRec {
+
+	int arity;
+	/* node index in the call graph, -1 if none. */
+	int fid;
+	unsigned char types[];
+}* Signature;
+
 /* The record in the bucket lists for
  * each variable, including name, assigned memory loc, 
  * and the list of line numbers 
@@ -27,16 +39,43 @@ typedef struct LineListRec {
 typedef struct BucketListRec {
 
 	char* name;
+	/* lines of the declaration and uses, the first
+	 * NULL without a declaration in the source. */
 	LineList lines;
+	LineList lastLine;
 	int memloc;
 
 	char VPF;
 	int type;
 	int len;
 	TreeNode* params;
+	/* signature of a function. */
+	Signature sig;
 	struct BucketListRec* next;
+	/* next record of the same scope in declaration order. */
+	struct BucketListRec* nextInScope;
+	/* scope the record is declared in. */
+	struct ScopeListRec* owner;
+	/* declaration of the same name hidden by this one,
+	 * while the scope is active in shadow stack mode. */
+	struct BucketListRec* shadowed;
+	/* reachable from main, set by markReachable. */
+	int live;
+	/* declared by an imported interface. */
+	int imported;
+	/* variable number of a local in the control
+	 * flow graph of its function, or -1. */
+	int index;
+	/* runtime function lowered to an instruction,
+	 * NO_INTRINSIC for any other record. */
+	int intrinsic;
 }* BucketList;
 
+/* Runtime functions declared by st_declareIntrinsics. */
+#define NO_INTRINSIC 0
+#define INPUT_INTRINSIC 1
+#define OUTPUT_INTRINSIC 2
+
 /* Wrapping structure of BucketList. */
 typedef struct ScopeListRec {
 
@@ -50,10 +89,37 @@ typedef struct ScopeListRec {
 	int level;
 	/* Parent ptr. */
 	struct ScopeListRec* parent;
+	/* records in declaration order. */
+	BucketList first;
+	BucketList last;
+	/* position in the scope list. */
+	int id;
 }* ScopeList;
 
-/* List of scopes. */
-extern ScopeList scope[];
+/* List of scopes in creation order. */
+extern ScopeList* scope;
+/* Number of scopes in the list. */
+extern int scope_index;
+
+/* If TRUE, every name keeps a stack of its active
+ * declarations, pushed by st_insert and scope_push and
+ * popped by scope_pop, so st_lookup and st_lookup_local
+ * take constant time regardless of nesting depth. 
+ * Otherwise the hash table of every enclosing scope 
+ * is searched. Must be set before the first scope is pushed.
+ */
+extern int ShadowStacks;
+
+/* Function st_intern returns the unique copy of a name.
+ * The copy carries its hash value, which is computed 
+ * once here instead of on every lookup. Every name passed 
+ * to the st_ procedures below must come from st_intern,
+ * so that names can be compared by pointer.
+ */
+char* st_intern (char* name);
+
+/* Function st_internN interns the first len characters of name. */
+char* st_internN (const char* name, size_t len);
 
 /* Procedure scope_top returns
  * current scope record. 
@@ -75,11 +141,49 @@ void scope_pop(void);
  */
 struct ScopeListRec* scope_new (void);
 
+/* Procedure scope_release frees the scopes created
+ * since the scope list held first scopes, with their 
+ * records, and takes them off the list. The scopes 
+ * must not be on the stack.
+ */
+void scope_release (int first);
+
 /* Procedure xt_insert inserts line numbers and
  * memory locations into the symbol table
  */
 void st_insert (char* name, int lineno, int loc, char VPF, int type, int len, TreeNode*);
 
+/* Function st_declare inserts a declaration into the
+ * current scope with a single search, and returns its
+ * record, or NULL if the name is already declared there.
+ */
+BucketList st_declare (char* name, int lineno, int loc, char VPF, int type, int len, TreeNode*);
+
+/* Procedure st_declareIntrinsics declares the runtime
+ * functions int input(void) and void output(int) in
+ * the current scope, before any declaration of the
+ * program. A program may declare the names itself,
+ * its declaration then replaces the intrinsic one.
+ */
+void st_declareIntrinsics (void);
+
+/* Function st_newSignature allocates the signature
+ * of a function with arity parameters, 
+ * the caller fills in the types.
+ */
+Signature st_newSignature (int arity);
+
+/* Function st_signature builds the signature of
+ * a function from its parameter list.
+ */
+Signature st_signature (TreeNode* params);
+
+/* Function st_reference looks up a name through the
+ * enclosing scopes and appends the line number to its
+ * record. Returns the record or NULL if not declared.
+ */
+BucketList st_reference (char* name, int lineno);
+
 /* Procedure st_insert_global inserts line number to 
  * the correspoinding scope that stays global.
  */
@@ -101,4 +205,20 @@ BucketList st_lookup_local (char* name);
  */
 void printSymTab (FILE* listing);
 
+/* Procedure printScopes prints the scopes of the
+ * scope list from first up to last as printSymTab does.
+ */
+void printScopes (FILE* listing, int first, int last);
+
+/* Procedure printSymTabJSON exports every scope 
+ * and symbol as a JSON document.
+ */
+void printSymTabJSON (FILE* out);
+
+/* Procedure printHashStats prints bucket occupancy 
+ * and chain length histograms of every scope 
+ * and of the name table.
+ */
+void printHashStats (FILE* out);
+
 #endif
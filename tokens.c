@@ -0,0 +1,439 @@
+#include <pthread.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "stats.h"
+#include "symtab.h"
+#include "tokens.h"
+
+int PreLex = FALSE;
+int ScanJobs = 0;
+
+/* Chunks smaller than this are not worth a thread. */
+#define MIN_CHUNK (64 * 1024)
+
+static TokenArray tokens;
+/* Next token to return. */
+static long cursor = 0;
+/* Token last returned by nextToken. */
+static TokenRec* current = NULL;
+
+/* Source read by the chunk scanner. */
+static char* src = NULL;
+static long srcSize = 0;
+
+/* A token found by the chunk scanner, 
+ * before its lexeme is interned. */
+typedef struct RawTokenRec {
+
+	TokenType type;
+	int lineno;
+	const char* text;
+	int len;
+} RawToken;
+
+/* A chunk of the source, split after a newline. */
+typedef struct ChunkRec {
+
+	long start;
+	long end;
+	/* newlines in the chunk. */
+	int lines;
+	/* comment state at the end of the chunk,
+	 * entered outside (0) or inside (1) a comment. */
+	int exitState[2];
+	/* resolved state and line at the start. */
+	int inComment;
+	int lineno;
+	int last;
+	RawToken* out;
+	long cnt;
+	long cap;
+} Chunk;
+
+/* Function growTokens makes room for one more element
+ * of size bytes in *a of *cap elements, holding cnt.
+ */
+static void* growTokens (void* a, long cnt, long* cap, size_t size) {
+
+	if (cnt < *cap)
+		return a;
+	*cap = *cap ? *cap * 2 : 1024;
+	a = realloc(a, *cap * size);
+	if (a == NULL) {
+		fprintf(stderr, "Out of memory for tokens\n");
+		exit(1);
+	}
+	return a;
+}
+
+static void push (Chunk* c, TokenType type, int lineno, 
+		const char* text, int len) {
+
+	RawToken* t;
+	c->out = (RawToken*) growTokens(c->out, c->cnt, &c->cap, sizeof(RawToken));
+	t = &c->out[c->cnt++];
+	t->type = type;
+	t->lineno = lineno;
+	t->text = text;
+	t->len = len;
+}
+
+static void append (TokenType type, int lineno, char* text) {
+
+	TokenRec* t;
+	tokens.toks = (TokenRec*) growTokens(tokens.toks, tokens.cnt, 
+			&tokens.cap, sizeof(TokenRec));
+	t = &tokens.toks[tokens.cnt++];
+	t->type = type;
+	t->lineno = lineno;
+	t->text = text;
+}
+
+/* Function constText returns the lexeme of a token 
+ * that has only one, or NULL.
+ */
+static char* constText (TokenType type) {
+
+	switch (type) {
+		case ELSE: return "else";
+		case IF: return "if";
+		case INT: return "int";
+		case RETURN: return "return";
+		case VOID: return "void";
+		case WHILE: return "while";
+		case ENDFILE: return "";
+		case ERROR_IN_COMMENT: return "/*";
+		case ID: case NUM: case ERROR: return NULL;
+		/* operators are their own label. */
+		default: return (char*) tokenLabel(type);
+	}
+}
+
+/* Lexemes of numbers and errors are not names, they are
+ * copied into blocks instead of the name table. */
+#define TEXT_BLOCK (64 * 1024)
+
+static char* textBlock = NULL;
+static size_t textUsed = TEXT_BLOCK;
+
+/* Function lexemeText returns the lexeme s of len characters
+ * of an ID, NUM or ERROR token, interned only for an ID.
+ */
+static char* lexemeText (TokenType type, const char* s, size_t len) {
+
+	char* t;
+	if (type == ID)
+		return st_internN(s, len);
+	if (textUsed + len + 1 > TEXT_BLOCK) {
+		textBlock = (char*) malloc(TEXT_BLOCK);
+		if (textBlock == NULL) {
+			fprintf(stderr, "Out of memory for tokens\n");
+			exit(1);
+		}
+		STAT_ALLOC(ScanM, TEXT_BLOCK);
+		textUsed = 0;
+	}
+	t = textBlock + textUsed;
+	memcpy(t, s, len);
+	t[len] = '\0';
+	textUsed += len + 1;
+	return t;
+}
+
+/* Function commentEnd returns the position after the
+ * "*" "/" closing a comment, or NULL if it is not in [p, end).
+ * Newlines passed are added to *lines.
+ */
+static const char* commentEnd (const char* p, const char* end, int* lines) {
+
+	for (; p < end; p++) {
+		if (*p == '\n')
+			(*lines)++;
+		else if (*p == '*' && p + 1 < end && p[1] == '/')
+			return p + 2;
+	}
+	return NULL;
+}
+
+/* Function scanState returns the comment state at the 
+ * end of a chunk entered in state inComment.
+ * Only comment delimiters are looked at.
+ */
+static int scanState (const char* p, const char* end, int inComment) {
+
+	int lines = 0;
+	while (p < end) {
+		if (inComment) {
+			if ((p = commentEnd(p, end, &lines)) == NULL)
+				return TRUE;
+			inComment = FALSE;
+		}
+		else {
+			p = memchr(p, '/', end - p);
+			if (p == NULL)
+				return FALSE;
+			if (p + 1 < end && p[1] == '*') {
+				inComment = TRUE;
+				p += 2;
+			}
+			else
+				p++;
+		}
+	}
+	return inComment;
+}
+
+static TokenType keyword (const char* s, int len) {
+
+	switch (len) {
+		case 2: if (memcmp(s, "if", 2) == 0) return IF; break;
+		case 3: if (memcmp(s, "int", 3) == 0) return INT; break;
+		case 4: 
+			if (memcmp(s, "else", 4) == 0) return ELSE; 
+			if (memcmp(s, "void", 4) == 0) return VOID; 
+			break;
+		case 5: if (memcmp(s, "while", 5) == 0) return WHILE; break;
+		case 6: if (memcmp(s, "return", 6) == 0) return RETURN; break;
+	}
+	return ID;
+}
+
+/* Procedure lexChunk tokenizes a chunk with the rules 
+ * of tiny.l, starting from its resolved comment state.
+ */
+static void lexChunk (Chunk* c) {
+
+	const char* p = src + c->start;
+	const char* end = src + c->end;
+	int line = c->lineno;
+	int inComment = c->inComment;
+
+	while (p < end) {
+		const char* s = p;
+		TokenType type;
+		if (inComment) {
+			/* Newlines inside a comment are still counted. */
+			p = commentEnd(p, end, &line);
+			if (p == NULL)
+				break;
+			inComment = FALSE;
+			continue;
+		}
+		switch (*p) {
+			case '\n': line++; p++; continue;
+			case ' ': case '\t': p++; continue;
+			case '+': type = PLUS; break;
+			case '-': type = MINUS; break;
+			case '*': type = TIMES; break;
+			case ';': type = SEMI; break;
+			case ',': type = COMMA; break;
+			case '(': type = LPAREN; break;
+			case ')': type = RPAREN; break;
+			case '[': type = LSQUARE; break;
+			case ']': type = RSQUARE; break;
+			case '{': type = LCURLY; break;
+			case '}': type = RCURLY; break;
+			case '/':
+				if (p + 1 < end && p[1] == '*') {
+					p += 2;
+					inComment = TRUE;
+					continue;
+				}
+				type = OVER;
+				break;
+			case '<': type = (p + 1 < end && p[1] == '=') ? LE : LT; break;
+			case '>': type = (p + 1 < end && p[1] == '=') ? GE : GT; break;
+			case '=': type = (p + 1 < end && p[1] == '=') ? EQ : ASSIGN; break;
+			case '!': type = (p + 1 < end && p[1] == '=') ? NE : ERROR; break;
+			default:
+				if (isdigit((unsigned char) *p)) {
+					while (++p < end && isdigit((unsigned char) *p))
+						;
+					push(c, NUM, line, s, p - s);
+				}
+				else if (isalpha((unsigned char) *p)) {
+					while (++p < end && isalpha((unsigned char) *p))
+						;
+					push(c, keyword(s, p - s), line, s, p - s);
+				}
+				else {
+					p++;
+					push(c, ERROR, line, s, 1);
+				}
+				continue;
+		}
+		p += (type == LE || type == GE || type == EQ || type == NE) ? 2 : 1;
+		push(c, type, line, s, p - s);
+	}
+	/* An open comment at the end of input is an error. */
+	if (inComment && c->last)
+		push(c, ERROR_IN_COMMENT, line, "/*", 2);
+}
+
+/* Worker procedures of the two parallel passes. */
+static void* stateWorker (void* arg) {
+
+	Chunk* c = (Chunk*) arg;
+	const char* p = src + c->start;
+	const char* end = src + c->end;
+	c->lines = 0;
+	while ((p = memchr(p, '\n', end - p)) != NULL) {
+		c->lines++;
+		p++;
+	}
+	p = src + c->start;
+	c->exitState[0] = scanState(p, end, FALSE);
+	c->exitState[1] = scanState(p, end, TRUE);
+	return NULL;
+}
+
+static void* lexWorker (void* arg) {
+
+	lexChunk((Chunk*) arg);
+	return NULL;
+}
+
+/* Procedure runAll runs proc on every chunk, 
+ * one thread per chunk. */
+static void runAll (Chunk* chunks, int n, void* (* proc) (void*)) {
+
+	pthread_t* threads = (pthread_t*) malloc(n * sizeof(pthread_t));
+	int i;
+	for (i = 1; i < n; i++)
+		if (pthread_create(&threads[i], NULL, proc, &chunks[i]) != 0) {
+			fprintf(stderr, "Unable to create thread\n");
+			exit(1);
+		}
+	proc(&chunks[0]);
+	for (i = 1; i < n; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+/* Procedure readAll reads the whole file into src. */
+static void readAll (FILE* in) {
+
+	long cap = 1 << 16;
+	size_t n;
+	src = (char*) malloc(cap);
+	srcSize = 0;
+	while ((n = fread(src + srcSize, 1, cap - srcSize, in)) > 0) {
+		srcSize += n;
+		if (srcSize == cap) {
+			cap *= 2;
+			src = (char*) realloc(src, cap);
+		}
+	}
+	STAT_ALLOC(ScanM, cap);
+}
+
+/* Procedure lexChunks tokenizes the source in chunks. */
+static void lexChunks (FILE* in) {
+
+	Chunk* chunks;
+	long size, pos, j;
+	int i, n, line;
+
+	readAll(in);
+	size = srcSize;
+	n = ScanJobs;
+	if (size / n < MIN_CHUNK)
+		n = size / MIN_CHUNK > 0 ? size / MIN_CHUNK : 1;
+	chunks = (Chunk*) calloc(n, sizeof(Chunk));
+
+	/* Split after the first newline past every n-th of the source. */
+	for (i = 0, pos = 0; i < n; i++) {
+		long end = i == n - 1 ? size : size / n * (i + 1);
+		const char* nl;
+		if (end < pos)
+			end = pos;
+		nl = end < size ? memchr(src + end, '\n', size - end) : NULL;
+		end = nl ? nl - src + 1 : size;
+		chunks[i].start = pos;
+		chunks[i].end = end;
+		pos = end;
+	}
+	chunks[n - 1].last = TRUE;
+
+	/* Lines and comment state transfer of every chunk, then the 
+	 * state and line at each chunk start, then the tokens. */
+	runAll(chunks, n, stateWorker);
+	for (i = 0, line = 1; i < n; i++) {
+		chunks[i].lineno = line;
+		chunks[i].inComment = i > 0 ? chunks[i - 1].exitState[chunks[i - 1].inComment] : FALSE;
+		line += chunks[i].lines;
+	}
+	runAll(chunks, n, lexWorker);
+
+	/* The name table is not shared, lexemes are interned here. */
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < chunks[i].cnt; j++) {
+			RawToken* r = &chunks[i].out[j];
+			char* text = constText(r->type);
+			if (text == NULL)
+				text = lexemeText(r->type, r->text,
+						r->len < MAXTOKENLEN ? r->len : MAXTOKENLEN);
+			append(r->type, r->lineno, text);
+		}
+		free(chunks[i].out);
+	}
+	append(ENDFILE, line, constText(ENDFILE));
+	STAT_ADD(tokens, tokens.cnt);
+	free(chunks);
+	free(src);
+	src = NULL;
+}
+
+void lexSource (FILE* in) {
+
+	tokens.cnt = 0;
+	if (ScanJobs > 0)
+		lexChunks(in);
+	else {
+		/* Tokens are listed as the parser reads them. */
+		int trace = TraceScan;
+		TokenType t;
+		TraceScan = FALSE;
+		do {
+			char* text;
+			t = getToken();
+			text = constText(t);
+			append(t, lineno, text ? text : lexemeText(t, tokenString, strlen(tokenString)));
+		} while (t != ENDFILE);
+		TraceScan = trace;
+	}
+	STAT_ALLOC(ScanM, tokens.cap * sizeof(TokenRec));
+	rewindTokens();
+}
+
+TokenArray* tokenArray (void) {
+
+	return &tokens;
+}
+
+void rewindTokens (void) {
+
+	cursor = 0;
+	current = NULL;
+}
+
+TokenType nextToken (void) {
+
+	TokenRec* t = &tokens.toks[cursor];
+	if (cursor < tokens.cnt - 1)
+		cursor++;
+	current = t;
+	lineno = t->lineno;
+	strcpy(tokenString, t->text);
+	if (TraceScan) {
+		fprintf(listing, "\t%d\t", lineno);
+		printToken(t->type, tokenString);
+	}
+	return t->type;
+}
+
+char* tokenName (void) {
+
+	return PreLex && current ? current->text : st_intern(tokenString);
+}
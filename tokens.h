@@ -0,0 +1,57 @@
+#ifndef _TOKENS_H_
+#define _TOKENS_H_
+
+/* A token of the source. */
+typedef struct TokenRec {
+
+	TokenType type;
+	int lineno;
+	/* lexeme as tokenString holds it: the interned atom of 
+	 * an ID, a copy for a NUM or ERROR, a constant string
+	 * otherwise. */
+	char* text;
+} TokenRec;
+
+/* Tokens of a whole source, ending with ENDFILE. */
+typedef struct TokenArrayRec {
+
+	TokenRec* toks;
+	long cnt;
+	long cap;
+} TokenArray;
+
+/* The parser reads tokens from the token array
+ * filled by lexSource, instead of calling getToken. */
+extern int PreLex;
+/* Threads lexing chunks of the source, 
+ * 0 to fill the token array through getToken. */
+extern int ScanJobs;
+
+/* Procedure lexSource scans the whole source into the 
+ * token array, in chunks on ScanJobs threads if 
+ * ScanJobs > 0, or else through getToken.
+ */
+void lexSource (FILE* in);
+
+/* Function tokenArray returns the tokens of the source,
+ * for tools that read them directly.
+ */
+TokenArray* tokenArray (void);
+
+/* Procedure rewindTokens makes nextToken start over,
+ * so the source can be parsed again without scanning.
+ */
+void rewindTokens (void);
+
+/* Function nextToken returns the next token of the 
+ * array, setting tokenString and lineno as getToken does.
+ * ENDFILE is returned repeatedly at the end.
+ */
+TokenType nextToken (void);
+
+/* Function tokenName returns the interned lexeme 
+ * of the current token.
+ */
+char* tokenName (void);
+
+#endif
@@ -1,103 +1,63 @@
 #include "globals.h"
 #include "util.h"
+#include "stats.h"
 
-void printToken(TokenType token, const char* tokenString) {
+/*
+ *	Function tokenLabel returns the name of a token
+ *	as shown in token listings.
+ */
+const char* tokenLabel(TokenType token) {
 	switch(token) {
-	case ELSE:
-		fprintf(listing, "\tELSE\t\t%s\n", tokenString);
-		break;
-	case IF:
-		fprintf(listing, "\tIF\t\t%s\n", tokenString);
-		break;
-	case INT:
-		fprintf(listing, "\tINT\t\t%s\n", tokenString);
-		break;
-	case RETURN:
-		fprintf(listing, "\tRETURN\t\t%s\n", tokenString);
-		break;
-	case VOID:
-		fprintf(listing, "\tVOID\t\t%s\n", tokenString);
-		break;
-	case WHILE:
-		fprintf(listing, "\tWHILE\t\t%s\n", tokenString);
-		break;
-	case PLUS:
-		fprintf(listing, "\t+\t\t%s\n", tokenString);
-		break;
-	case MINUS:
-		fprintf(listing, "\t-\t\t%s\n", tokenString);
-		break;
-	case TIMES:
-		fprintf(listing, "\t*\t\t%s\n", tokenString);
-		break;
-	case OVER:
-		fprintf(listing, "\t/\t\t%s\n", tokenString);
-		break;
-	case LT:
-		fprintf(listing, "\t<\t\t%s\n", tokenString);
-		break;
-	case LE:
-		fprintf(listing, "\t<=\t\t%s\n", tokenString);
-		break;
-	case GT:
-		fprintf(listing, "\t>\t\t%s\n", tokenString);
-		break;
-	case GE:
-		fprintf(listing, "\t>=\t\t%s\n", tokenString);
-		break;
-	case EQ:
-		fprintf(listing, "\t==\t\t%s\n", tokenString);
-		break;
-	case NE:
-		fprintf(listing, "\t!=\t\t%s\n", tokenString);
-		break;
-	case ASSIGN:
-		fprintf(listing, "\t=\t\t%s\n", tokenString);
-		break;
-	case SEMI:
-		fprintf(listing, "\t;\t\t%s\n", tokenString);
-		break;
-	case COMMA:
-		fprintf(listing, "\t,\t\t%s\n", tokenString);
-		break;
-	case LPAREN:
-		fprintf(listing, "\t(\t\t%s\n", tokenString);
-		break;
-	case RPAREN:
-		fprintf(listing, "\t)\t\t%s\n", tokenString);
-		break;
-	case LSQUARE:
-		fprintf(listing, "\t[\t\t%s\n", tokenString);
-		break;
-	case RSQUARE:
-		fprintf(listing, "\t]\t\t%s\n", tokenString);
-		break;
-	case LCURLY:
-		fprintf(listing, "\t{\t\t%s\n", tokenString);
-		break;
-	case RCURLY:
-		fprintf(listing, "\t}\t\t%s\n", tokenString);
-		break;
-	case ENDFILE:
-		fprintf(listing, "\tEOF\t\t\n");
-		break;
-	case NUM:
-		fprintf(listing, "\tNUM\t\t%s\n", tokenString);
-		break;
-	case ID:
-		fprintf(listing, "\tID\t\t%s\n", tokenString);
-		break;
-	case ERROR:
-		fprintf(listing, "\tERROR\t\t%s\n", tokenString);
-		break;
-	case ERROR_IN_COMMENT:
-		fprintf(listing, "\tERROR\t\tComment Error\n");
-		break;
-	default:
-		fprintf(listing, "\tUnknown\t\t%s\n", tokenString);
+	case ELSE: return "ELSE";
+	case IF: return "IF";
+	case INT: return "INT";
+	case RETURN: return "RETURN";
+	case VOID: return "VOID";
+	case WHILE: return "WHILE";
+	case PLUS: return "+";
+	case MINUS: return "-";
+	case TIMES: return "*";
+	case OVER: return "/";
+	case LT: return "<";
+	case LE: return "<=";
+	case GT: return ">";
+	case GE: return ">=";
+	case EQ: return "==";
+	case NE: return "!=";
+	case ASSIGN: return "=";
+	case SEMI: return ";";
+	case COMMA: return ",";
+	case LPAREN: return "(";
+	case RPAREN: return ")";
+	case LSQUARE: return "[";
+	case RSQUARE: return "]";
+	case LCURLY: return "{";
+	case RCURLY: return "}";
+	case ENDFILE: return "EOF";
+	case NUM: return "NUM";
+	case ID: return "ID";
+	case ERROR: return "ERROR";
+	case ERROR_IN_COMMENT: return "ERROR";
+	default: return "Unknown";
 	}
 }
 
+/*
+ *	Function tokenLexeme returns the lexeme printed 
+ *	after the name of a token.
+ */
+const char* tokenLexeme(TokenType token, const char* tokenString) {
+	switch(token) {
+	case ENDFILE: return "";
+	case ERROR_IN_COMMENT: return "Comment Error";
+	default: return tokenString;
+	}
+}
+
+void printToken(TokenType token, const char* tokenString) {
+	fprintf(listing, "\t%s\t\t%s\n", tokenLabel(token), tokenLexeme(token, tokenString));
+}
+
 /* 
  *	Function newStmtNode creates a new statement
  *	node for syntax tree construction. 
@@ -112,6 +72,11 @@ TreeNode* newStmtNode(StmtKind kind) {
 		for (i = 0; i < MAXCHILDREN;i++)
 			t->child[i] = NULL;
 		t->sibling = NULL;
+		t->flags = 0;
+		t->sym = NULL;
+		t->scope = NULL;
+		STAT_INC(nodes[StmtK]);
+		STAT_ALLOC(AstM, sizeof(TreeNode));
 		t->nodekind = StmtK;
 		t->kind.stmt = kind;
 		t->lineno = lineno;
@@ -132,6 +97,11 @@ TreeNode* newExpNode (ExpKind kind) {
 		for (i = 0; i < MAXCHILDREN; i++)
 			t->child[i] = NULL;
 		t->sibling = NULL;
+		t->flags = 0;
+		t->sym = NULL;
+		t->scope = NULL;
+		STAT_INC(nodes[ExpK]);
+		STAT_ALLOC(AstM, sizeof(TreeNode));
 		t->nodekind = ExpK;
 		t->kind.exp = kind;
 		t->lineno = lineno;
@@ -150,6 +120,11 @@ TreeNode* newDeclNode (DeclKind kind) {
 		for (i = 0; i < MAXCHILDREN; i++)
 			t->child[i] = NULL;
 		t->sibling = NULL;
+		t->flags = 0;
+		t->sym = NULL;
+		t->scope = NULL;
+		STAT_INC(nodes[DeclK]);
+		STAT_ALLOC(AstM, sizeof(TreeNode));
 		t->nodekind = DeclK;
 		t->kind.decl = kind;
 		t->lineno = lineno;
@@ -168,6 +143,11 @@ TreeNode* newTypeNode (TypeKind kind) {
 		for (i = 0; i < MAXCHILDREN; i++)
 			t->child[i] = NULL;
 		t->sibling = NULL;
+		t->flags = 0;
+		t->sym = NULL;
+		t->scope = NULL;
+		STAT_INC(nodes[TypeK]);
+		STAT_ALLOC(AstM, sizeof(TreeNode));
 		t->nodekind = TypeK;
 		t->kind.type = kind;
 		t->lineno = lineno;
@@ -178,6 +158,22 @@ TreeNode* newTypeNode (TypeKind kind) {
 
 
 
+/*
+ *	Procedure freeTree frees the nodes of a syntax tree,
+ *	walking sibling lists iteratively.
+ */
+void freeTree (TreeNode* t) {
+
+	int i;
+	while (t != NULL) {
+		TreeNode* next = t->sibling;
+		for (i = 0; i < MAXCHILDREN; i++)
+			freeTree(t->child[i]);
+		free(t);
+		t = next;
+	}
+}
+
 /*
  *	Function copyString allocates and maeks a new copy
  *	of an existing string.
@@ -191,8 +187,10 @@ char* copyString (char* s) {
 	t = malloc(n);
 	if (!t)
 		fprintf(listing, "Out of memory error at line %d\n", lineno);
-	else
+	else {
+		STAT_ALLOC(ScanM, n);
 		strcpy(t, s);
+	}
 	return t;
 }
 
@@ -321,3 +319,81 @@ void printTree (TreeNode* tree){
 	}
 	UNINDENT;
 }
+
+/* Size of the output buffer. */
+#define OUTBUF_SIZE 65536
+
+static char outBuf[OUTBUF_SIZE];
+static int outLen = 0;
+static FILE* outFile = NULL;
+
+/*
+ *	Procedure outFlush writes the buffered output.
+ */
+void outFlush (void) {
+
+	if (outLen > 0 && outFile)
+		fwrite(outBuf, 1, outLen, outFile);
+	outLen = 0;
+}
+
+/*
+ *	Procedure outOpen directs the buffered output to f.
+ */
+void outOpen (FILE* f) {
+
+	outFlush();
+	outFile = f;
+}
+
+void outChar (char c) {
+
+	if (outLen == OUTBUF_SIZE)
+		outFlush();
+	outBuf[outLen++] = c;
+}
+
+void outStr (const char* s) {
+
+	while (*s) {
+		if (outLen == OUTBUF_SIZE)
+			outFlush();
+		outBuf[outLen++] = *s++;
+	}
+}
+
+/*
+ *	Procedure outPad writes s left justified 
+ *	in a field of width characters, like %-*s.
+ */
+void outPad (const char* s, int width) {
+
+	const char* p = s;
+	outStr(s);
+	while (*p)
+		p++;
+	for (width -= p - s; width > 0; width--)
+		outChar(' ');
+}
+
+/*
+ *	Procedure outInt writes v left justified
+ *	in a field of width characters, like %-*ld.
+ */
+void outInt (long v, int width) {
+
+	char digits[24];
+	int n = 0;
+	unsigned long u = v < 0 ? -(unsigned long) v : (unsigned long) v;
+	do {
+		digits[n++] = '0' + u % 10;
+		u /= 10;
+	} while (u > 0);
+	if (v < 0)
+		digits[n++] = '-';
+	width -= n;
+	while (n > 0)
+		outChar(digits[--n]);
+	for (; width > 0; width--)
+		outChar(' ');
+}
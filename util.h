@@ -7,6 +7,13 @@
  */
 void printToken(TokenType, const char*);
 
+/*
+ *	Returns the name and the printed lexeme 
+ *	of a token, as used by printToken.
+ */
+const char* tokenLabel(TokenType);
+const char* tokenLexeme(TokenType, const char*);
+
 /*
  *	Creates a new statement node ofr syntax tree 
  *	construction.
@@ -37,9 +44,28 @@ TreeNode* newTypeNode (TypeKind);
  */
 char* copyString(char*);
 
+/*
+ *	Frees a syntax tree with its siblings.
+ */
+void freeTree(TreeNode*);
+
 /*
  *	Prints a syntax tree to the listing file
  *	using indentation to indicate subtrees. 
  */
 void printTree(TreeNode*);
+
+/*
+ *	Buffered writer for bulk listings. 
+ *	outOpen directs the buffer to a file, outStr, outPad, 
+ *	outInt and outChar append to it, and outFlush writes 
+ *	the buffer out. Call outFlush before writing to the
+ *	same file by other means.
+ */
+void outOpen(FILE*);
+void outStr(const char*);
+void outPad(const char*, int width);
+void outInt(long, int width);
+void outChar(char);
+void outFlush(void);
 #endif
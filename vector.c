@@ -0,0 +1,242 @@
+#include "globals.h"
+#include "symtab.h"
+#include "vector.h"
+
+int Vectorize = FALSE;
+
+/* Outcome of the check of a while loop. */
+typedef enum {VectorR, NotCountedR, ControlR, ScalarR, CallR,
+	SubscriptR, DependenceR, REASON_CNT} Reason;
+
+static const char* reasonName[REASON_CNT] = {"vectorized", "not counted",
+	"control flow", "scalar assignment", "call", "subscript", "dependence"};
+
+static long loops[REASON_CNT];
+
+/* An array element of the loop body, array[i + off]. */
+typedef struct {
+	BucketList array;
+	int off;
+	int store;
+} Access;
+
+static Access* acc = NULL;
+static int accCnt = 0;
+static int accCap = 0;
+
+/* induction variable of the loop being checked */
+static BucketList iv;
+
+static int isScalar (TreeNode* t) {
+
+	return t != NULL && t->nodekind == ExpK && t->kind.exp == IdK
+			&& t->child[0] == NULL && t->sym != NULL && t->sym->type == Integer;
+}
+
+static int isConst (TreeNode* t) {
+
+	return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+static int isAssign (TreeNode* t) {
+
+	return t != NULL && t->nodekind == ExpK && t->kind.exp == OpK
+			&& t->attr.op == ASSIGN;
+}
+
+/* Function isIncrement returns TRUE for i = i + 1. */
+static int isIncrement (TreeNode* t) {
+
+	TreeNode* e;
+
+	if (!isAssign(t) || !isScalar(t->child[0]) || t->child[0]->sym != iv)
+		return FALSE;
+	e = t->child[1];
+	if (e->nodekind != ExpK || e->kind.exp != OpK || e->attr.op != PLUS)
+		return FALSE;
+	return (isScalar(e->child[0]) && e->child[0]->sym == iv
+				&& isConst(e->child[1]) && e->child[1]->attr.val == 1)
+			|| (isScalar(e->child[1]) && e->child[1]->sym == iv
+				&& isConst(e->child[0]) && e->child[0]->attr.val == 1);
+}
+
+/* Function offset stores in off the constant c of a
+ * subscript i, i + c, c + i or i - c. Returns FALSE
+ * for any other subscript. */
+static int offset (TreeNode* t, int* off) {
+
+	if (isScalar(t) && t->sym == iv) {
+		*off = 0;
+		return TRUE;
+	}
+	if (t->nodekind != ExpK || t->kind.exp != OpK
+			|| (t->attr.op != PLUS && t->attr.op != MINUS))
+		return FALSE;
+	if (isScalar(t->child[0]) && t->child[0]->sym == iv && isConst(t->child[1])) {
+		*off = t->attr.op == PLUS ? t->child[1]->attr.val : -t->child[1]->attr.val;
+		return TRUE;
+	}
+	if (t->attr.op == PLUS && isScalar(t->child[1]) && t->child[1]->sym == iv
+			&& isConst(t->child[0])) {
+		*off = t->child[0]->attr.val;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static Reason access (TreeNode* t, int store) {
+
+	int off;
+
+	if (!offset(t->child[0], &off))
+		return SubscriptR;
+	if (accCnt == accCap) {
+		accCap = accCap ? accCap * 2 : 16;
+		acc = (Access*) realloc(acc, accCap * sizeof(Access));
+		if (acc == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	acc[accCnt].array = t->sym;
+	acc[accCnt].off = off;
+	acc[accCnt].store = store;
+	accCnt++;
+	return VectorR;
+}
+
+/* Function operand checks an expression read by the body. */
+static Reason operand (TreeNode* t) {
+
+	Reason r;
+
+	if (t == NULL)
+		return VectorR;
+	switch (t->kind.exp) {
+		case ConstK:
+			return VectorR;
+		case IdK:
+			if (t->sym == NULL)
+				return ScalarR;
+			if (t->child[0] != NULL)
+				return access(t, FALSE);
+			/* scalars other than i are loop invariant */
+			return t->sym->type == Integer ? VectorR : SubscriptR;
+		case CallK:
+			return CallR;
+		case OpK:
+			if (t->attr.op == ASSIGN)
+				return ScalarR;
+			if ((r = operand(t->child[0])) != VectorR)
+				return r;
+			return operand(t->child[1]);
+		default:
+			return ControlR;
+	}
+}
+
+/* Function mayAlias returns TRUE if a and b may be the same
+ * array, an array parameter may be any array. */
+static int mayAlias (BucketList a, BucketList b) {
+
+	return a == b || a->VPF == 'P' || b->VPF == 'P';
+}
+
+/* Function classify returns why while loop t is not
+ * vectorized, or VectorR. */
+static Reason classify (TreeNode* t) {
+
+	TreeNode* c = t->child[0], * body = t->child[1], * s;
+	Reason r;
+	int i, j;
+
+	if (c == NULL || c->nodekind != ExpK || c->kind.exp != OpK
+			|| (c->attr.op != LT && c->attr.op != LE) || !isScalar(c->child[0]))
+		return NotCountedR;
+	iv = c->child[0]->sym;
+	if (!isConst(c->child[1]) && !(isScalar(c->child[1]) && c->child[1]->sym != iv))
+		return NotCountedR;
+	if (body == NULL)
+		return NotCountedR;
+	if (body->nodekind == StmtK && body->kind.stmt == CompoundK) {
+		if (body->child[0] != NULL)
+			return ControlR;
+		body = body->child[1];
+	}
+	for (s = body; s != NULL && s->sibling != NULL; s = s->sibling)
+		;
+	if (s == NULL || !isIncrement(s))
+		return NotCountedR;
+
+	accCnt = 0;
+	for (s = body; s->sibling != NULL; s = s->sibling) {
+		if (s->nodekind != ExpK || (s->flags & PARTIAL))
+			return ControlR;
+		if (!isAssign(s))
+			return operand(s) == CallR ? CallR : ControlR;
+		if (s->child[0]->child[0] == NULL || s->child[0]->sym == NULL
+				|| s->child[0]->sym->type != Array)
+			return ScalarR;
+		if ((r = operand(s->child[1])) != VectorR)
+			return r;
+		if ((r = access(s->child[0], TRUE)) != VectorR)
+			return r;
+	}
+	/* a store and another access i + a and i + b,
+	 * a != b, of one array cross iterations */
+	for (i = 0; i < accCnt; i++)
+		for (j = 0; j < accCnt; j++)
+			if (i != j && acc[i].store && acc[i].off != acc[j].off
+					&& mayAlias(acc[i].array, acc[j].array))
+				return DependenceR;
+	return VectorR;
+}
+
+/* Procedure walk checks the while loops of t. */
+static void walk (TreeNode* t) {
+
+	int i;
+
+	for (; t != NULL; t = t->sibling) {
+		if (t->flags & PARTIAL)
+			continue;
+		if (t->nodekind == StmtK && t->kind.stmt == WhileK) {
+			Reason r = classify(t);
+			loops[r]++;
+			if (r == VectorR)
+				t->flags |= VECTOR_LOOP;
+		}
+		for (i = 0; i < MAXCHILDREN; i++)
+			walk(t->child[i]);
+	}
+}
+
+void vectorDeclaration (TreeNode* t) {
+
+	if (t == NULL || t->nodekind != DeclK || t->kind.decl != FunK
+			|| (t->flags & PARTIAL))
+		return;
+	walk(t->child[2]);
+}
+
+void vectorCheck (TreeNode* syntaxTree) {
+
+	TreeNode* t;
+
+	for (t = syntaxTree; t != NULL; t = t->sibling)
+		vectorDeclaration(t);
+}
+
+void printVectorReport (FILE* out) {
+
+	long total = 0;
+	int i;
+
+	for (i = 0; i < REASON_CNT; i++)
+		total += loops[i];
+	fprintf(out, "Vectorize: %ld of %ld while loops vectorized by %d",
+			loops[VectorR], total, VECTOR_WIDTH);
+	for (i = 1; i < REASON_CNT; i++)
+		fprintf(out, ", %ld %s", loops[i], reasonName[i]);
+	fprintf(out, "\n");
+}
@@ -0,0 +1,31 @@
+#ifndef _VECTOR_H_
+#define _VECTOR_H_
+
+/* Iterations of a vectorized loop run by one pass of its body. */
+#define VECTOR_WIDTH 4
+
+/* Find the counted loops the code generator strip mines. */
+extern int Vectorize;
+
+/* Procedure vectorDeclaration marks the counted while loops
+ * of a function body with VECTOR_LOOP. Such a loop tests a
+ * scalar i against a constant or scalar bound with < or <=,
+ * ends its body with i = i + 1, and otherwise only assigns
+ * array elements subscripted by i plus a constant, without
+ * calls. Two accesses of the same array, or of arrays that
+ * may alias through a parameter, at different offsets from
+ * i are a loop carried dependence and keep the loop scalar.
+ */
+void vectorDeclaration (TreeNode* t);
+
+/* Procedure vectorCheck marks the loops of
+ * every function of the syntax tree.
+ */
+void vectorCheck (TreeNode* syntaxTree);
+
+/* Procedure printVectorReport prints how many while
+ * loops were vectorized, and why the others were not.
+ */
+void printVectorReport (FILE* out);
+
+#endif